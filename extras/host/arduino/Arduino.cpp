@@ -0,0 +1,89 @@
+/*
+  Virtual clock, pin stubs and Serial for the host build.
+*/
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+static uint64_t hostClockMicros = 0;
+static uint32_t hostSpinCost = 1;
+
+uint64_t hostMicros() {
+    return hostClockMicros;
+}
+
+void hostAdvanceMicros(uint64_t us) {
+    hostClockMicros += us;
+}
+
+void hostSpin() {
+    hostClockMicros += hostSpinCost;
+}
+
+void hostSetSpinCost(uint32_t us) {
+    hostSpinCost = us;
+}
+
+unsigned long millis() {
+    hostSpin();
+
+    return (unsigned long) (hostClockMicros / 1000);
+}
+
+unsigned long micros() {
+    hostSpin();
+
+    return (unsigned long) hostClockMicros;
+}
+
+void delay(unsigned long ms) {
+    hostClockMicros += (uint64_t) ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    hostClockMicros += us;
+}
+
+void yield() {
+    hostSpin();
+}
+
+void pinMode(uint8_t /*pin*/, uint8_t /*mode*/) {
+}
+
+void digitalWrite(uint8_t /*pin*/, uint8_t /*val*/) {
+}
+
+int digitalRead(uint8_t /*pin*/) {
+    return HIGH;
+}
+
+class HostConsole : public HardwareSerial {
+public:
+    void begin(unsigned long /*baud*/) override {}
+
+    void end() override {}
+
+    int available() override { return 0; }
+
+    int read() override { return -1; }
+
+    int peek() override { return -1; }
+
+    size_t write(uint8_t c) override {
+        return fwrite(&c, 1, 1, stdout);
+    }
+
+    size_t write(const uint8_t *buf, size_t size) override {
+        return fwrite(buf, 1, size, stdout);
+    }
+
+    void flush() override {
+        fflush(stdout);
+    }
+};
+
+static HostConsole hostConsole;
+
+HardwareSerial &Serial = hostConsole;
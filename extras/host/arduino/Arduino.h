@@ -0,0 +1,67 @@
+/*
+  Minimal Arduino core shim used to build the library on a Linux host.
+
+  Only the parts of the Arduino API used by the library are provided. Time is
+  virtual: delay() advances the clock immediately and every call to millis(),
+  micros() or an empty UART poll costs a small "spin" quantum, so busy-wait
+  loops in the library make progress without sleeping on the host.
+*/
+
+#ifndef _HOST_ARDUINO_H_INCLUDED
+#define _HOST_ARDUINO_H_INCLUDED
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PROGMEM
+#define PGM_P const char *
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+#define F(string_literal) (string_literal)
+
+unsigned long millis();
+
+unsigned long micros();
+
+void delay(unsigned long ms);
+
+void delayMicroseconds(unsigned int us);
+
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+
+void digitalWrite(uint8_t pin, uint8_t val);
+
+int digitalRead(uint8_t pin);
+
+// Host-only control of the virtual clock
+uint64_t hostMicros();
+
+void hostAdvanceMicros(uint64_t us);
+
+void hostSpin();
+
+void hostSetSpinCost(uint32_t us);
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+#include "HardwareSerial.h"
+
+#endif
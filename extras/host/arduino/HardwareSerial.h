@@ -0,0 +1,21 @@
+/*
+  HardwareSerial interface for the host build.
+*/
+
+#ifndef _HOST_HARDWARE_SERIAL_H_INCLUDED
+#define _HOST_HARDWARE_SERIAL_H_INCLUDED
+
+#include "Stream.h"
+
+class HardwareSerial : public Stream {
+public:
+    virtual void begin(unsigned long baud) = 0;
+
+    virtual void end() = 0;
+
+    operator bool() { return true; }
+};
+
+extern HardwareSerial &Serial;
+
+#endif
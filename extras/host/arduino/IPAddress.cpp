@@ -0,0 +1,76 @@
+/*
+  IPv4 address class for the host build.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "IPAddress.h"
+
+IPAddress::IPAddress() {
+    memset(_address, 0, sizeof(_address));
+}
+
+IPAddress::IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet) {
+    _address[0] = first_octet;
+    _address[1] = second_octet;
+    _address[2] = third_octet;
+    _address[3] = fourth_octet;
+}
+
+IPAddress::IPAddress(uint32_t address) {
+    memcpy(_address, &address, sizeof(_address));
+}
+
+IPAddress::IPAddress(const uint8_t *address) {
+    memcpy(_address, address, sizeof(_address));
+}
+
+bool IPAddress::fromString(const char *address) {
+    uint16_t acc = 0;
+    uint8_t dots = 0;
+
+    while (*address) {
+        char c = *address++;
+
+        if (c >= '0' && c <= '9') {
+            acc = acc * 10 + (c - '0');
+            if (acc > 255) {
+                return false;
+            }
+        } else if (c == '.') {
+            if (dots == 3) {
+                return false;
+            }
+            _address[dots++] = (uint8_t) acc;
+            acc = 0;
+        } else {
+            return false;
+        }
+    }
+
+    if (dots != 3) {
+        return false;
+    }
+
+    _address[3] = (uint8_t) acc;
+    return true;
+}
+
+IPAddress::operator uint32_t() const {
+    uint32_t address;
+
+    memcpy(&address, _address, sizeof(address));
+    return address;
+}
+
+bool IPAddress::operator==(const IPAddress &addr) const {
+    return memcmp(_address, addr._address, sizeof(_address)) == 0;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+    return String(buf);
+}
@@ -0,0 +1,40 @@
+/*
+  IPv4 address class for the host build.
+*/
+
+#ifndef _HOST_IPADDRESS_H_INCLUDED
+#define _HOST_IPADDRESS_H_INCLUDED
+
+#include <stdint.h>
+
+#include "WString.h"
+
+class IPAddress {
+public:
+    IPAddress();
+
+    IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet);
+
+    IPAddress(uint32_t address);
+
+    IPAddress(const uint8_t *address);
+
+    bool fromString(const char *address);
+
+    bool fromString(const String &address) { return fromString(address.c_str()); }
+
+    operator uint32_t() const;
+
+    bool operator==(const IPAddress &addr) const;
+
+    uint8_t operator[](int index) const { return _address[index]; }
+
+    uint8_t &operator[](int index) { return _address[index]; }
+
+    String toString() const;
+
+private:
+    uint8_t _address[4];
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+  Print base class for the host build.
+*/
+
+#include <stdio.h>
+
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+
+    while (size--) {
+        if (write(*buffer++)) {
+            n++;
+        } else {
+            break;
+        }
+    }
+
+    return n;
+}
+
+size_t Print::print(const String &s) {
+    return write((const uint8_t *) s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[]) {
+    return write(str);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t) c);
+}
+
+size_t Print::print(unsigned char n, int base) {
+    return print((unsigned long) n, base);
+}
+
+size_t Print::print(int n, int base) {
+    return print((long) n, base);
+}
+
+size_t Print::print(unsigned int n, int base) {
+    return print((unsigned long) n, base);
+}
+
+size_t Print::print(long n, int base) {
+    return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(unsigned long n, int base) {
+    return print(String(n, (unsigned char) base));
+}
+
+size_t Print::print(double n, int digits) {
+    char buf[48];
+
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return write(buf);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::println(const String &s) {
+    size_t n = print(s);
+    return n + println();
+}
+
+size_t Print::println(const char str[]) {
+    size_t n = print(str);
+    return n + println();
+}
+
+size_t Print::println(char c) {
+    size_t n = print(c);
+    return n + println();
+}
+
+size_t Print::println(unsigned char n, int base) {
+    size_t r = print(n, base);
+    return r + println();
+}
+
+size_t Print::println(int n, int base) {
+    size_t r = print(n, base);
+    return r + println();
+}
+
+size_t Print::println(unsigned int n, int base) {
+    size_t r = print(n, base);
+    return r + println();
+}
+
+size_t Print::println(long n, int base) {
+    size_t r = print(n, base);
+    return r + println();
+}
+
+size_t Print::println(unsigned long n, int base) {
+    size_t r = print(n, base);
+    return r + println();
+}
+
+size_t Print::println(double n, int digits) {
+    size_t r = print(n, digits);
+    return r + println();
+}
@@ -0,0 +1,91 @@
+/*
+  Print base class for the host build.
+*/
+
+#ifndef _HOST_PRINT_H_INCLUDED
+#define _HOST_PRINT_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    int getWriteError() { return _writeError; }
+
+    void clearWriteError() { setWriteError(0); }
+
+    virtual size_t write(uint8_t) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size);
+
+    size_t write(const char *str) {
+        if (str == nullptr) {
+            return 0;
+        }
+        return write((const uint8_t *) str, strlen(str));
+    }
+
+    size_t write(const char *buffer, size_t size) {
+        return write((const uint8_t *) buffer, size);
+    }
+
+    virtual int availableForWrite() { return 0; }
+
+    virtual void flush() {}
+
+    size_t print(const String &s);
+
+    size_t print(const char str[]);
+
+    size_t print(char c);
+
+    size_t print(unsigned char n, int base = DEC);
+
+    size_t print(int n, int base = DEC);
+
+    size_t print(unsigned int n, int base = DEC);
+
+    size_t print(long n, int base = DEC);
+
+    size_t print(unsigned long n, int base = DEC);
+
+    size_t print(double n, int digits = 2);
+
+    size_t println();
+
+    size_t println(const String &s);
+
+    size_t println(const char str[]);
+
+    size_t println(char c);
+
+    size_t println(unsigned char n, int base = DEC);
+
+    size_t println(int n, int base = DEC);
+
+    size_t println(unsigned int n, int base = DEC);
+
+    size_t println(long n, int base = DEC);
+
+    size_t println(unsigned long n, int base = DEC);
+
+    size_t println(double n, int digits = 2);
+
+protected:
+    void setWriteError(int err = 1) { _writeError = err; }
+
+private:
+    int _writeError = 0;
+};
+
+#endif
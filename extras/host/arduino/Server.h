@@ -0,0 +1,15 @@
+/*
+  Server interface for the host build.
+*/
+
+#ifndef _HOST_SERVER_H_INCLUDED
+#define _HOST_SERVER_H_INCLUDED
+
+#include "Print.h"
+
+class Server : public Print {
+public:
+    virtual void begin() = 0;
+};
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  Stream base class for the host build.
+*/
+
+#ifndef _HOST_STREAM_H_INCLUDED
+#define _HOST_STREAM_H_INCLUDED
+
+#include "Print.h"
+
+class Stream : public Print {
+public:
+    Stream() : _timeout(1000) {}
+
+    virtual int available() = 0;
+
+    virtual int read() = 0;
+
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+
+    unsigned long getTimeout() const { return _timeout; }
+
+    size_t readBytes(char *buffer, size_t length);
+
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *) buffer, length); }
+
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) {
+        return readBytesUntil(terminator, (char *) buffer, length);
+    }
+
+    String readString();
+
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long _timeout;
+
+    int timedRead();
+};
+
+#endif
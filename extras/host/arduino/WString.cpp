@@ -0,0 +1,452 @@
+/*
+  Heap backed String for the host build.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WString.h"
+
+static void formatNumber(char *buf, size_t size, unsigned long value, unsigned char base, bool negative) {
+    char tmp[8 * sizeof(unsigned long) + 2];
+    char *p = &tmp[sizeof(tmp) - 1];
+
+    *p = '\0';
+    if (base < 2) {
+        base = 10;
+    }
+
+    do {
+        unsigned long digit = value % base;
+        *--p = (char) (digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+
+    if (negative) {
+        *--p = '-';
+    }
+
+    snprintf(buf, size, "%s", p);
+}
+
+String::String(const char *cstr) : _buffer(nullptr), _capacity(0), _len(0) {
+    if (cstr) {
+        copy(cstr, strlen(cstr));
+    }
+}
+
+String::String(const char *cstr, unsigned int length) : _buffer(nullptr), _capacity(0), _len(0) {
+    if (cstr) {
+        copy(cstr, length);
+    }
+}
+
+String::String(const String &str) : _buffer(nullptr), _capacity(0), _len(0) {
+    copy(str.c_str(), str._len);
+}
+
+String::String(String &&str) noexcept : _buffer(str._buffer), _capacity(str._capacity), _len(str._len) {
+    str._buffer = nullptr;
+    str._capacity = 0;
+    str._len = 0;
+}
+
+String::String(char c) : _buffer(nullptr), _capacity(0), _len(0) {
+    copy(&c, 1);
+}
+
+String::String(unsigned char value, unsigned char base) : String((unsigned long) value, base) {
+}
+
+String::String(int value, unsigned char base) : String((long) value, base) {
+}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long) value, base) {
+}
+
+String::String(long value, unsigned char base) : _buffer(nullptr), _capacity(0), _len(0) {
+    char buf[8 * sizeof(long) + 2];
+
+    if (base == 10 && value < 0) {
+        formatNumber(buf, sizeof(buf), 0UL - (unsigned long) value, base, true);
+    } else {
+        formatNumber(buf, sizeof(buf), (unsigned long) value, base, false);
+    }
+    copy(buf, strlen(buf));
+}
+
+String::String(unsigned long value, unsigned char base) : _buffer(nullptr), _capacity(0), _len(0) {
+    char buf[8 * sizeof(unsigned long) + 2];
+
+    formatNumber(buf, sizeof(buf), value, base, false);
+    copy(buf, strlen(buf));
+}
+
+String::~String() {
+    free(_buffer);
+}
+
+void String::invalidate() {
+    free(_buffer);
+    _buffer = nullptr;
+    _capacity = _len = 0;
+}
+
+unsigned char String::changeBuffer(unsigned int maxStrLen) {
+    char *newBuffer = (char *) realloc(_buffer, maxStrLen + 1);
+
+    if (newBuffer) {
+        _buffer = newBuffer;
+        _capacity = maxStrLen;
+        return 1;
+    }
+
+    return 0;
+}
+
+unsigned char String::reserve(unsigned int size) {
+    if (_buffer && _capacity >= size) {
+        return 1;
+    }
+
+    if (changeBuffer(size)) {
+        if (_len == 0) {
+            _buffer[0] = '\0';
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+    if (!reserve(length)) {
+        invalidate();
+        return *this;
+    }
+
+    _len = length;
+    memmove(_buffer, cstr, length);
+    _buffer[_len] = '\0';
+
+    return *this;
+}
+
+String &String::operator=(const String &rhs) {
+    if (this != &rhs) {
+        copy(rhs.c_str(), rhs._len);
+    }
+
+    return *this;
+}
+
+String &String::operator=(String &&rhs) noexcept {
+    if (this != &rhs) {
+        free(_buffer);
+        _buffer = rhs._buffer;
+        _capacity = rhs._capacity;
+        _len = rhs._len;
+        rhs._buffer = nullptr;
+        rhs._capacity = 0;
+        rhs._len = 0;
+    }
+
+    return *this;
+}
+
+String &String::operator=(const char *cstr) {
+    if (cstr) {
+        copy(cstr, strlen(cstr));
+    } else {
+        invalidate();
+    }
+
+    return *this;
+}
+
+unsigned char String::concat(const char *cstr, unsigned int length) {
+    unsigned int newLen = _len + length;
+
+    if (!cstr) {
+        return 0;
+    }
+
+    if (length == 0) {
+        return 1;
+    }
+
+    // like the AVR/SAMD cores, grow to exactly the new length unless reserve() was called
+    if (!reserve(newLen)) {
+        return 0;
+    }
+
+    memmove(_buffer + _len, cstr, length);
+    _len = newLen;
+    _buffer[_len] = '\0';
+
+    return 1;
+}
+
+unsigned char String::concat(const String &str) {
+    return concat(str.c_str(), str._len);
+}
+
+unsigned char String::concat(const char *cstr) {
+    if (!cstr) {
+        return 0;
+    }
+
+    return concat(cstr, strlen(cstr));
+}
+
+unsigned char String::concat(char c) {
+    return concat(&c, 1);
+}
+
+unsigned char String::concat(unsigned char num) {
+    return concat(String(num));
+}
+
+unsigned char String::concat(int num) {
+    return concat(String(num));
+}
+
+unsigned char String::concat(unsigned int num) {
+    return concat(String(num));
+}
+
+unsigned char String::concat(long num) {
+    return concat(String(num));
+}
+
+unsigned char String::concat(unsigned long num) {
+    return concat(String(num));
+}
+
+bool String::equals(const String &s) const {
+    return _len == s._len && memcmp(c_str(), s.c_str(), _len) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+    return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    if (_len < prefix._len) {
+        return false;
+    }
+
+    return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+    if (offset > _len - prefix._len || !_buffer || !prefix._buffer) {
+        return false;
+    }
+
+    return strncmp(&_buffer[offset], prefix._buffer, prefix._len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    if (_len < suffix._len || !_buffer || !suffix._buffer) {
+        return false;
+    }
+
+    return strcmp(&_buffer[_len - suffix._len], suffix._buffer) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _len) {
+        _buffer[index] = c;
+    }
+}
+
+char String::operator[](unsigned int index) const {
+    if (index >= _len || !_buffer) {
+        return 0;
+    }
+
+    return _buffer[index];
+}
+
+char &String::operator[](unsigned int index) {
+    static char dummy;
+
+    if (index >= _len || !_buffer) {
+        dummy = 0;
+        return dummy;
+    }
+
+    return _buffer[index];
+}
+
+int String::indexOf(char ch) const {
+    return indexOf(ch, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+
+    const char *found = (const char *) memchr(_buffer + fromIndex, ch, _len - fromIndex);
+
+    return found ? (int) (found - _buffer) : -1;
+}
+
+int String::indexOf(const String &str) const {
+    return indexOf(str, 0);
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+
+    const char *found = strstr(_buffer + fromIndex, str.c_str());
+
+    return found ? (int) (found - _buffer) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    return _len ? lastIndexOf(ch, _len - 1) : -1;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _len) {
+        return -1;
+    }
+
+    for (int i = (int) fromIndex; i >= 0; i--) {
+        if (_buffer[i] == ch) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int String::lastIndexOf(const String &str) const {
+    if (str._len > _len) {
+        return -1;
+    }
+
+    return lastIndexOf(str, _len - str._len);
+}
+
+int String::lastIndexOf(const String &str, unsigned int fromIndex) const {
+    if (str._len == 0 || _len == 0 || str._len > _len) {
+        return -1;
+    }
+
+    if (fromIndex >= _len) {
+        fromIndex = _len - 1;
+    }
+
+    int found = -1;
+
+    // same forward scan as the Arduino cores, which is what makes it O(n) per call
+    for (char *p = _buffer; p <= _buffer + fromIndex; p++) {
+        p = strstr(p, str._buffer);
+        if (!p) {
+            break;
+        }
+        if ((unsigned int) (p - _buffer) <= fromIndex) {
+            found = (int) (p - _buffer);
+        }
+    }
+
+    return found;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if (left > right) {
+        unsigned int temp = right;
+        right = left;
+        left = temp;
+    }
+
+    if (left >= _len) {
+        return String();
+    }
+
+    if (right > _len) {
+        right = _len;
+    }
+
+    return String(_buffer + left, right - left);
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int) -1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _len || count == 0) {
+        return;
+    }
+
+    if (count > _len - index) {
+        count = _len - index;
+    }
+
+    memmove(_buffer + index, _buffer + index + count, _len - index - count);
+    _len -= count;
+    _buffer[_len] = '\0';
+}
+
+void String::trim() {
+    if (!_buffer || _len == 0) {
+        return;
+    }
+
+    char *begin = _buffer;
+    while (isspace((unsigned char) *begin)) {
+        begin++;
+    }
+
+    char *end = _buffer + _len - 1;
+    while (end >= begin && isspace((unsigned char) *end)) {
+        end--;
+    }
+
+    _len = end + 1 - begin;
+    if (begin > _buffer) {
+        memmove(_buffer, begin, _len);
+    }
+    _buffer[_len] = '\0';
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < _len; i++) {
+        _buffer[i] = (char) toupper((unsigned char) _buffer[i]);
+    }
+}
+
+long String::toInt() const {
+    return _buffer ? atol(_buffer) : 0;
+}
+
+String operator+(const String &lhs, const String &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+    String result(lhs);
+    result += rhs;
+    return result;
+}
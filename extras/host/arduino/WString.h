@@ -0,0 +1,155 @@
+/*
+  Heap backed String compatible with the subset of the Arduino WString API
+  used by the library.
+*/
+
+#ifndef _HOST_WSTRING_H_INCLUDED
+#define _HOST_WSTRING_H_INCLUDED
+
+#include <stddef.h>
+
+class String {
+public:
+    String(const char *cstr = "");
+
+    String(const char *cstr, unsigned int length);
+
+    String(const String &str);
+
+    String(String &&str) noexcept;
+
+    explicit String(char c);
+
+    explicit String(unsigned char value, unsigned char base = 10);
+
+    explicit String(int value, unsigned char base = 10);
+
+    explicit String(unsigned int value, unsigned char base = 10);
+
+    explicit String(long value, unsigned char base = 10);
+
+    explicit String(unsigned long value, unsigned char base = 10);
+
+    ~String();
+
+    String &operator=(const String &rhs);
+
+    String &operator=(String &&rhs) noexcept;
+
+    String &operator=(const char *cstr);
+
+    unsigned char reserve(unsigned int size);
+
+    unsigned int length() const { return _len; }
+
+    const char *c_str() const { return _buffer ? _buffer : ""; }
+
+    unsigned char concat(const String &str);
+
+    unsigned char concat(const char *cstr);
+
+    unsigned char concat(const char *cstr, unsigned int length);
+
+    unsigned char concat(char c);
+
+    unsigned char concat(unsigned char num);
+
+    unsigned char concat(int num);
+
+    unsigned char concat(unsigned int num);
+
+    unsigned char concat(long num);
+
+    unsigned char concat(unsigned long num);
+
+    String &operator+=(const String &rhs) { concat(rhs); return *this; }
+
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+
+    String &operator+=(char c) { concat(c); return *this; }
+
+    String &operator+=(unsigned char num) { concat(num); return *this; }
+
+    String &operator+=(int num) { concat(num); return *this; }
+
+    String &operator+=(unsigned int num) { concat(num); return *this; }
+
+    String &operator+=(long num) { concat(num); return *this; }
+
+    String &operator+=(unsigned long num) { concat(num); return *this; }
+
+    bool equals(const String &s) const;
+
+    bool equals(const char *cstr) const;
+
+    bool operator==(const String &rhs) const { return equals(rhs); }
+
+    bool operator==(const char *cstr) const { return equals(cstr); }
+
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+
+    bool startsWith(const String &prefix) const;
+
+    bool startsWith(const String &prefix, unsigned int offset) const;
+
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const;
+
+    void setCharAt(unsigned int index, char c);
+
+    char operator[](unsigned int index) const;
+
+    char &operator[](unsigned int index);
+
+    int indexOf(char ch) const;
+
+    int indexOf(char ch, unsigned int fromIndex) const;
+
+    int indexOf(const String &str) const;
+
+    int indexOf(const String &str, unsigned int fromIndex) const;
+
+    int lastIndexOf(char ch) const;
+
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+
+    int lastIndexOf(const String &str) const;
+
+    int lastIndexOf(const String &str, unsigned int fromIndex) const;
+
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void remove(unsigned int index);
+
+    void remove(unsigned int index, unsigned int count);
+
+    void trim();
+
+    void toUpperCase();
+
+    long toInt() const;
+
+private:
+    char *_buffer;
+    unsigned int _capacity;
+    unsigned int _len;
+
+    void invalidate();
+
+    unsigned char changeBuffer(unsigned int maxStrLen);
+
+    String &copy(const char *cstr, unsigned int length);
+};
+
+String operator+(const String &lhs, const String &rhs);
+
+String operator+(const String &lhs, const char *rhs);
+
+String operator+(const char *lhs, const String &rhs);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+  Small helpers shared by the host benchmarks.
+*/
+
+#ifndef _BENCH_UTIL_H_INCLUDED
+#define _BENCH_UTIL_H_INCLUDED
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+
+#include <Arduino.h>
+
+// Measures both host CPU (wall) time and virtual device time
+class BenchTimer {
+public:
+    BenchTimer() { restart(); }
+
+    void restart() {
+        _wallStart = std::chrono::steady_clock::now();
+        _virtualStart = hostMicros();
+    }
+
+    double wallMicros() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - _wallStart).count();
+    }
+
+    double virtualMillis() const {
+        return (double) (hostMicros() - _virtualStart) / 1000.0;
+    }
+
+private:
+    std::chrono::steady_clock::time_point _wallStart;
+    uint64_t _virtualStart;
+};
+
+#define BENCH_CHECK(cond)                                                           \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                                \
+        }                                                                           \
+    } while (0)
+
+// Payload of the given size, the seed tells payloads in one bench apart
+static inline std::string benchPattern(size_t size, int seed = 7) {
+    std::string data;
+
+    for (size_t i = 0; i < size; i++) {
+        data += (char) (i * 31 + seed);
+    }
+
+    return data;
+}
+
+// State of an async connect, filled in by benchConnected()
+struct BenchConnect {
+    bool done;
+    int result;
+};
+
+static inline void benchConnected(int result, void *context) {
+    BenchConnect *run = (BenchConnect *) context;
+
+    run->done = true;
+    run->result = result;
+}
+
+static inline void benchHeader(const char *title) {
+    printf("\n== %s ==\n", title);
+    printf("%-34s %14s %14s %10s\n", "case", "virtual ms", "host us", "AT cmds");
+}
+
+static inline void benchRow(const char *name, double virtualMs, double wallUs, unsigned long commands) {
+    printf("%-34s %14.1f %14.1f %10lu\n", name, virtualMs, wallUs, commands);
+}
+
+#endif
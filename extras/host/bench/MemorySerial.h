@@ -0,0 +1,41 @@
+/*
+  Serial port for the host benchmarks that replays an in-memory byte stream.
+*/
+
+#ifndef _MEMORY_SERIAL_H_INCLUDED
+#define _MEMORY_SERIAL_H_INCLUDED
+
+#include <string>
+
+#include <Arduino.h>
+
+// Serial port replaying an in-memory byte stream as fast as it is read
+class MemorySerial : public HardwareSerial {
+public:
+    void load(const std::string &data) {
+        _data = data;
+        _pos = 0;
+    }
+
+    void begin(unsigned long) override {}
+
+    void end() override {}
+
+    int available() override { return (int) (_data.size() - _pos); }
+
+    int read() override { return _pos < _data.size() ? (uint8_t) _data[_pos++] : -1; }
+
+    int peek() override { return _pos < _data.size() ? (uint8_t) _data[_pos] : -1; }
+
+    size_t write(uint8_t) override { return 1; }
+
+    size_t write(const uint8_t *, size_t size) override { return size; }
+
+    using Print::write;
+
+private:
+    std::string _data;
+    size_t _pos = 0;
+};
+
+#endif
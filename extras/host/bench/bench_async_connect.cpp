@@ -0,0 +1,166 @@
+/*
+  Event-driven connect against the simulated SARA-R4.
+
+  Connects with the blocking connect() and with connectAsync() from a sketch
+  loop that does 5 ms of its own work and polls the modem, with and without
+  SSL. Reports the time until the connection is up, the longest the sketch
+  loop was held up by the library and the time of each connect phase. Then
+  checks the failure reasons of a refused connect and of a stopped one, and
+  that both close the socket they created, as does a client destroyed while
+  it connects.
+*/
+
+#include <algorithm>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void printTimes(const NBClient &client) {
+    printf("%-34s %14lu\n", "  create ms", client.connectTimes().create);
+    printf("%-34s %14lu\n", "  secure ms", client.connectTimes().secure);
+    printf("%-34s %14lu\n", "  connect ms", client.connectTimes().connect);
+}
+
+static void blocking(Modem &modem, FakeSaraR4 &sara, bool ssl, const char *name) {
+    NBClient client(modem);
+
+    sara.clearLog();
+    BenchTimer timer;
+    BENCH_CHECK(ssl ? client.connectSSL("example.org", 443) : client.connect("example.org", 80));
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(client.connected());
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14.1f\n", "  longest loop ms", ms);
+    printTimes(client);
+
+    client.stop();
+}
+
+static int loopUntilDone(Modem &modem, BenchConnect &run, double &longestMs) {
+    unsigned long start = millis();
+
+    longestMs = 0;
+    while (!run.done && millis() - start < 10000) {
+        BenchTimer iteration;
+
+        modem.poll();
+        // the sketch's own work
+        delay(5);
+
+        longestMs = std::max(longestMs, iteration.virtualMillis());
+    }
+
+    return run.done ? run.result : -1;
+}
+
+static void async(Modem &modem, FakeSaraR4 &sara, bool ssl, const char *name) {
+    NBClient client(modem);
+    BenchConnect run = {false, -1};
+    double longestMs;
+
+    sara.clearLog();
+    BenchTimer timer;
+    BENCH_CHECK(ssl ? client.connectSSLAsync("example.org", 443, benchConnected, &run)
+                    : client.connectAsync("example.org", 80, benchConnected, &run));
+    BENCH_CHECK(client.connecting());
+    BENCH_CHECK(loopUntilDone(modem, run, longestMs) == NB_CONNECT_OK);
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(!client.connecting() && client.connected());
+    BENCH_CHECK(sara.socketConnected(sara.lastCreatedSocket()));
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14.1f\n", "  longest loop ms", longestMs);
+    printTimes(client);
+
+    client.stop();
+}
+
+static void failures(Modem &modem, FakeSaraR4 &sara) {
+    NBClient client(modem);
+    BenchConnect run = {false, -1};
+    double longestMs;
+
+    // the server refuses
+    sara.failNext("AT+USOCO", "+CME ERROR: Operation not allowed");
+    BENCH_CHECK(client.connectAsync("example.org", 80, benchConnected, &run));
+    BENCH_CHECK(loopUntilDone(modem, run, longestMs) == NB_CONNECT_FAILED);
+    BENCH_CHECK(!client.connected() && !sara.socketOpen(sara.lastCreatedSocket()));
+
+    // no socket left
+    run = {false, -1};
+    sara.failNext("AT+USOCR", "+CME ERROR: Operation not allowed");
+    BENCH_CHECK(client.connectSSLAsync("example.org", 443, benchConnected, &run));
+    BENCH_CHECK(loopUntilDone(modem, run, longestMs) == NB_CONNECT_CREATE_FAILED);
+
+    // stopped while the socket is being created
+    run = {false, -1};
+    BENCH_CHECK(client.connectAsync("example.org", 80, benchConnected, &run));
+    BENCH_CHECK(!client.connectAsync("example.org", 80, benchConnected, &run));
+    client.stop();
+    BENCH_CHECK(loopUntilDone(modem, run, longestMs) == NB_CONNECT_ABORTED);
+    BENCH_CHECK(!sara.socketOpen(sara.lastCreatedSocket()));
+
+    // a host name the command queue can't hold
+    static const char longHost[] = "a-host-name-much-too-long-for-the-queue.example.org";
+    BENCH_CHECK(!client.connectAsync(longHost, 80, benchConnected, &run));
+
+    // a blocking connect works after all that
+    BENCH_CHECK(client.connect("example.org", 80));
+    client.stop();
+}
+
+static void destroyed(Modem &modem, FakeSaraR4 &sara) {
+    // before AT+USOCR was sent, while it runs and while AT+USOCO runs
+    static const char *const sentVerbs[] = {nullptr, "AT+USOCR", "AT+USOCO"};
+
+    for (const char *verb : sentVerbs) {
+        BenchConnect run = {false, -1};
+
+        sara.clearLog();
+        {
+            NBClient client(modem);
+
+            BENCH_CHECK(client.connectAsync("example.org", 80, benchConnected, &run));
+            while (verb != nullptr && sara.commandCount(verb) == 0) {
+                modem.waitForData(5);
+                modem.poll();
+            }
+        }
+
+        unsigned long start = millis();
+        while (modem.queued() > 0 && millis() - start < 15000) {
+            modem.waitForData(100);
+            modem.poll();
+        }
+        BENCH_CHECK(!run.done && modem.queued() == 0);
+        for (int socket = 0; socket < MODEM_NUM_SOCKETS; socket++) {
+            BENCH_CHECK(!sara.socketOpen(socket));
+        }
+    }
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    benchHeader("Connect");
+    blocking(modem, sara, false, "connect()");
+    async(modem, sara, false, "connectAsync(), 5 ms loop");
+    blocking(modem, sara, true, "connectSSL()");
+    async(modem, sara, true, "connectSSLAsync(), 5 ms loop");
+
+    failures(modem, sara);
+    destroyed(modem, sara);
+
+    return 0;
+}
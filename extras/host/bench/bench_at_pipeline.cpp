@@ -0,0 +1,152 @@
+/*
+  End-to-end AT pipeline benchmark against the simulated SARA-R4.
+
+  Runs a complete session (network registration, PDP attach, TCP download,
+  UDP exchange, SMS round trip, TLS connect with a certificate upload) and
+  reports virtual device time, host CPU time and AT commands per phase,
+  followed by the per command statistics recorded by the Modem.
+  Every phase checks its data, so the benchmark also fails loudly when a
+  change breaks the AT pipeline.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const uint8_t CERT_DATA[600] = {0x30, 0x82, 0x02, 0x54};
+
+static NBSecurityData cert = {"BenchRoot", CERT_DATA, NBSecurityData::CA, sizeof(CERT_DATA), false};
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    ModemStats stats;
+
+    modem.setStats(&stats);
+    benchHeader("AT pipeline");
+
+    NB nb(modem);
+    GPRS gprs(modem);
+    {
+        BenchTimer timer;
+        BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+        BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+        benchRow("register + attach", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    }
+
+    {
+        NBClient client(modem);
+        std::string body = benchPattern(4096);
+        std::string request = "GET / HTTP/1.1\r\nHost: example.org\r\nConnection: close\r\n\r\n";
+        std::string received;
+
+        sara.clearLog();
+        BenchTimer timer;
+
+        BENCH_CHECK(client.connect("example.org", 80));
+        int socket = sara.lastCreatedSocket();
+
+        client.print(request.c_str());
+
+        sara.peerSend(socket, body, 50);
+        sara.peerClose(socket, 60);
+
+        uint8_t buf[128];
+        unsigned long start = millis();
+        while (received.size() < body.size() && millis() - start < 60000) {
+            int n = client.read(buf, sizeof(buf));
+            if (n > 0) {
+                received.append((const char *) buf, n);
+            }
+        }
+        BENCH_CHECK(received == body);
+        BENCH_CHECK(sara.peerReceived(socket) == request);
+        client.stop();
+
+        benchRow("TCP request + 4 KB download", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    }
+
+    {
+        NBUDP udp(modem);
+        uint8_t packet[48] = {0xe3, 0, 6, 0xec};
+        std::string reply = benchPattern(48);
+
+        sara.clearLog();
+        BenchTimer timer;
+
+        BENCH_CHECK(udp.begin(2390));
+        int socket = sara.lastCreatedSocket();
+
+        BENCH_CHECK(udp.beginPacket("time.nist.gov", 123));
+        BENCH_CHECK(udp.write(packet, sizeof(packet)) == sizeof(packet));
+        BENCH_CHECK(udp.endPacket());
+        BENCH_CHECK(sara.datagramsSent().back().data == std::string((const char *) packet, sizeof(packet)));
+
+        sara.peerSendFrom(socket, "132.163.97.1", 123, reply, 80);
+
+        int size = 0;
+        unsigned long start = millis();
+        while ((size = udp.parsePacket()) == 0 && millis() - start < 5000) {
+        }
+        BENCH_CHECK(size == (int) reply.size());
+        BENCH_CHECK(udp.remotePort() == 123);
+        udp.stop();
+
+        benchRow("UDP request + reply", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    }
+
+    {
+        NB_SMS sms(modem);
+
+        sara.clearLog();
+        BenchTimer timer;
+
+        BENCH_CHECK(sms.beginSMS("+15550100"));
+        sms.print("bench message");
+        BENCH_CHECK(sms.endSMS() == 1);
+
+        sara.deliverSms("+15550199", "incoming bench message");
+        delay(10);
+
+        BENCH_CHECK(sms.available() > 0);
+        char number[20];
+        BENCH_CHECK(sms.remoteNumber(number, sizeof(number)) == 1);
+        BENCH_CHECK(String(number) == "+15550199");
+
+        String text;
+        int c;
+        while ((c = sms.read()) != -1) {
+            text += (char) c;
+        }
+        BENCH_CHECK(text == "incoming bench message");
+        sms.flush();
+
+        benchRow("SMS send + receive", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    }
+
+    {
+        NBSecurityData *certs[] = {&cert};
+        NBSSLClient client(modem, certs, 1);
+
+        sara.clearLog();
+        BenchTimer timer;
+
+        BENCH_CHECK(client.connect("example.org", 443));
+        BENCH_CHECK(sara.commandCount("AT+USECMNG") == 1);
+        BENCH_CHECK(sara.commandCount("AT+USOSEC") == 1);
+        client.stop();
+
+        benchRow("TLS connect + cert upload", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    }
+
+    const ModemCommandStats *usord = stats.find("AT+USORD");
+    BENCH_CHECK(usord != nullptr && usord->count > 0 && usord->errors == 0);
+
+    printf("\n== Modem statistics ==\n");
+    stats.dump(Serial);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+  Command queue versus a hand-rolled ready() state machine.
+
+  A sketch loop doing some milliseconds of its own work per iteration reads
+  six status values from the simulated SARA-R4, once with a state machine in
+  the style of NB::ready() (send in one state, collect the response in the
+  next) and once with the commands queued on the Modem with completion
+  callbacks. Reports the virtual time to complete all commands and the part
+  of it the sketch spent blocked inside the library. Checks that a queued
+  command leaves the result of the last sent one alone.
+*/
+
+#include <string>
+
+#include <Modem.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const char *const COMMANDS[] = {
+        "AT+CSQ",
+        "AT+CEREG?",
+        "AT+CCLK?",
+        "AT+CGSN",
+        "AT+CCID",
+        "AT+CGPADDR=1",
+};
+
+static const int NUM_COMMANDS = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+struct QueueRun {
+    Modem *modem;
+    int next;
+    int completed;
+    String responses[NUM_COMMANDS];
+};
+
+static void onCompleted(int result, const String &response, void *context) {
+    QueueRun *run = (QueueRun *) context;
+
+    BENCH_CHECK(result == MODEM_RESULT_OK);
+    run->responses[run->completed++] = response;
+
+    // keep the queue topped up, the way several subsystems would share it
+    if (run->next < NUM_COMMANDS) {
+        BENCH_CHECK(run->modem->enqueue(COMMANDS[run->next++], 1000, onCompleted, run));
+    }
+}
+
+struct Result {
+    double totalMs;
+    double blockedMs;
+    unsigned long commands;
+};
+
+static Result runStateMachine(unsigned long loopWorkMs, String *responses) {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    String response;
+    enum {
+        SEND,
+        WAIT_RESPONSE
+    } state = SEND;
+    int index = 0;
+    unsigned long iterations = 0;
+
+    delay(100);
+    BenchTimer timer;
+    while (index < NUM_COMMANDS) {
+        switch (state) {
+            case SEND:
+                modem.setResponseDataStorage(&response);
+                modem.send(COMMANDS[index]);
+                state = WAIT_RESPONSE;
+                break;
+
+            case WAIT_RESPONSE: {
+                int ready = modem.ready();
+                if (ready != 0) {
+                    BENCH_CHECK(ready == MODEM_RESULT_OK);
+                    responses[index++] = response;
+                    state = SEND;
+                }
+                break;
+            }
+        }
+
+        delay(loopWorkMs);
+        iterations++;
+    }
+    double ms = timer.virtualMillis();
+
+    return {ms, ms - (double) (iterations * loopWorkMs), sara.commandCount()};
+}
+
+static Result runQueue(unsigned long loopWorkMs, const String *expected) {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    QueueRun run;
+    unsigned long iterations = 0;
+
+    run.modem = &modem;
+    run.next = 0;
+    run.completed = 0;
+
+    delay(100);
+    BenchTimer timer;
+    for (; run.next < MODEM_COMMAND_QUEUE_SIZE && run.next < NUM_COMMANDS; run.next++) {
+        BENCH_CHECK(modem.enqueue(COMMANDS[run.next], 1000, onCompleted, &run));
+    }
+
+    while (run.completed < NUM_COMMANDS) {
+        modem.poll();
+        delay(loopWorkMs);
+        iterations++;
+    }
+    double ms = timer.virtualMillis();
+
+    for (int i = 0; i < NUM_COMMANDS; i++) {
+        BENCH_CHECK(run.responses[i] == expected[i]);
+    }
+    BENCH_CHECK(modem.queued() == 0);
+
+    return {ms, ms - (double) (iterations * loopWorkMs), sara.commandCount()};
+}
+
+int main() {
+    const unsigned long loopWorkMs[] = {1, 5, 25};
+
+    printf("\n== Command queue ==\n");
+    printf("%-34s %14s %14s %10s\n", "case", "virtual ms", "blocked ms", "AT cmds");
+
+    for (unsigned long work : loopWorkMs) {
+        String responses[NUM_COMMANDS];
+        char name[64];
+
+        Result machine = runStateMachine(work, responses);
+        snprintf(name, sizeof(name), "ready() state machine, %lu ms loop", work);
+        printf("%-34s %14.1f %14.1f %10lu\n", name, machine.totalMs, machine.blockedMs, machine.commands);
+
+        Result queue = runQueue(work, responses);
+        snprintf(name, sizeof(name), "command queue, %lu ms loop", work);
+        printf("%-34s %14.1f %14.1f %10lu\n", name, queue.totalMs, queue.blockedMs, queue.commands);
+    }
+
+    // a queued command completing leaves the result and error code of the sent one alone
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    QueueRun run = {&modem, NUM_COMMANDS, 0, {}};
+
+    delay(100);
+    sara.failNext("AT+CCID", "+CME ERROR: Operation not allowed");
+    modem.send("AT+CCID");
+    BENCH_CHECK(modem.waitForResponse(1000) == MODEM_RESULT_CME_ERROR);
+    BENCH_CHECK(modem.enqueue("AT+CSQ", 1000, onCompleted, &run));
+    while (run.completed == 0) {
+        modem.poll();
+        delay(1);
+    }
+    BENCH_CHECK(modem.lastResult() == MODEM_RESULT_CME_ERROR);
+    BENCH_CHECK(modem.lastErrorCode() == MODEM_CME_OPERATION_NOT_ALLOWED);
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*
+  Hex encoding of socket payloads.
+
+  Builds the AT+USOWR command for a chunk of payload the way NBClient::write
+  used to, appending two characters per byte to a String, and with
+  NBHex::encode into a preallocated command buffer. Then decodes the matching
+  +USORD response the way the socket buffer used to, trimming the
+  String around the payload, and with NBHex::decodeQuoted straight into the
+  socket buffer. Checks that both produce the same result and reports the
+  host time per chunk.
+*/
+
+#include <ctype.h>
+#include <string.h>
+
+#include <Arduino.h>
+
+#include <utility/NBHex.h>
+
+#include "BenchUtil.h"
+
+static void legacyCommand(String &command, int socket, const uint8_t *buf, size_t size) {
+    command.reserve(19 + size * 2);
+
+    command = "AT+USOWR=";
+    command += socket;
+    command += ",";
+    command += size;
+    command += ",\"";
+
+    for (size_t i = 0; i < size; i++) {
+        byte b = buf[i];
+
+        byte n1 = (b >> 4) & 0x0f;
+        byte n2 = (b & 0x0f);
+
+        command += (char) (n1 > 9 ? 'A' + n1 - 10 : '0' + n1);
+        command += (char) (n2 > 9 ? 'A' + n2 - 10 : '0' + n2);
+    }
+
+    command += "\"";
+}
+
+static size_t tableCommand(char *command, size_t capacity, int socket, const uint8_t *buf, size_t size) {
+    int length = snprintf(command, capacity, "AT+USOWR=%d,%u,\"", socket, (unsigned int) size);
+
+    length += NBHex::encode(buf, size, command + length);
+    command[length++] = '"';
+    command[length] = '\0';
+
+    return length;
+}
+
+static int legacyDecode(String response, uint8_t *data) {
+    int firstQuoteIndex = response.indexOf("\"");
+
+    response.remove(0, firstQuoteIndex + 1);
+    response.remove(response.length() - 1);
+
+    size_t size = response.length() / 2;
+
+    for (size_t i = 0; i < size; i++) {
+        byte n1 = response[i * 2];
+        byte n2 = response[i * 2 + 1];
+
+        if (n1 > '9') {
+            n1 = (n1 - 'A') + 10;
+        } else {
+            n1 = (n1 - '0');
+        }
+
+        if (n2 > '9') {
+            n2 = (n2 - 'A') + 10;
+        } else {
+            n2 = (n2 - '0');
+        }
+
+        data[i] = (n1 << 4) | n2;
+    }
+
+    return size;
+}
+
+static String usordResponse(const uint8_t *buf, size_t size) {
+    String response = "+USORD: 0,";
+    char hex[NB_HEX_LENGTH(512) + 1];
+
+    hex[NBHex::encode(buf, size, hex)] = '\0';
+    response += size;
+    response += ",\"";
+    response += hex;
+    response += "\"";
+
+    return response;
+}
+
+int main() {
+    const size_t sizes[] = {16, 64, 256, 512};
+    const int repeat = 20000;
+    static uint8_t payload[512];
+    static char command[24 + NB_HEX_LENGTH(sizeof(payload))];
+    volatile size_t sink = 0;
+
+    for (size_t i = 0; i < sizeof(payload); i++) {
+        payload[i] = (uint8_t) (i * 37 + 11);
+    }
+
+    printf("\n== Hex encoding (%s) ==\n",
+#if defined(__SSE2__)
+           "SSE2"
+#else
+           "scalar"
+#endif
+    );
+    printf("%-10s %18s %18s %10s\n", "bytes", "String ns/chunk", "table ns/chunk", "speedup");
+
+    for (size_t size : sizes) {
+        String legacy;
+
+        legacyCommand(legacy, 0, payload, size);
+        BENCH_CHECK(tableCommand(command, sizeof(command), 0, payload, size) == legacy.length());
+        BENCH_CHECK(strcmp(command, legacy.c_str()) == 0);
+
+        BenchTimer timer;
+        for (int r = 0; r < repeat; r++) {
+            String string;
+
+            payload[0] = (uint8_t) r;
+            legacyCommand(string, r % 7, payload, size);
+            sink += string.length();
+        }
+        double legacyNs = timer.wallMicros() * 1000.0 / repeat;
+
+        timer.restart();
+        for (int r = 0; r < repeat; r++) {
+            payload[0] = (uint8_t) r;
+            sink += tableCommand(command, sizeof(command), r % 7, payload, size);
+        }
+        double tableNs = timer.wallMicros() * 1000.0 / repeat;
+
+        printf("%-10zu %18.1f %18.1f %9.1fx\n", size, legacyNs, tableNs, legacyNs / tableNs);
+    }
+
+    printf("\n== Hex decoding ==\n");
+    printf("%-10s %18s %18s %10s\n", "bytes", "String ns/chunk", "table ns/chunk", "speedup");
+
+    for (size_t size : sizes) {
+        String response = usordResponse(payload, size);
+        uint8_t legacy[512];
+        uint8_t decoded[512];
+
+        BENCH_CHECK(legacyDecode(response, legacy) == (int) size);
+        BENCH_CHECK(NBHex::decodeQuoted(response.c_str(), response.length(), decoded, sizeof(decoded)) == (int) size);
+        BENCH_CHECK(memcmp(legacy, payload, size) == 0 && memcmp(decoded, payload, size) == 0);
+
+        BenchTimer timer;
+        for (int r = 0; r < repeat; r++) {
+            // the response was a copy of the received line in both versions
+            sink += legacyDecode(response, legacy);
+        }
+        double legacyNs = timer.wallMicros() * 1000.0 / repeat;
+
+        timer.restart();
+        for (int r = 0; r < repeat; r++) {
+            sink += NBHex::decodeQuoted(response.c_str(), response.length(), decoded, sizeof(decoded));
+        }
+        double tableNs = timer.wallMicros() * 1000.0 / repeat;
+
+        printf("%-10zu %18.1f %18.1f %9.1fx\n", size, legacyNs, tableNs, legacyNs / tableNs);
+    }
+
+    // lower case is accepted, anything else is rejected
+    uint8_t byte;
+    BENCH_CHECK(NBHex::decode("aF", 2, &byte) == 1 && byte == 0xaf);
+    BENCH_CHECK(NBHex::decode("G0", 2, &byte) == -1);
+    BENCH_CHECK(NBHex::decode("A", 1, &byte) == -1);
+
+    // every character, in a high and a low nibble of the 16 byte block and of the byte after it
+    static const size_t positions[] = {4, 5, 32, 33};
+    uint8_t bytes[17];
+    for (int c = 0; c < 256; c++) {
+        bool digit = isxdigit(c) != 0;
+
+        for (size_t position : positions) {
+            char hex[34];
+
+            memset(hex, '7', sizeof(hex));
+            hex[position] = (char) c;
+            BENCH_CHECK(NBHex::decode(hex, sizeof(hex), bytes) == (digit ? 17 : -1));
+        }
+    }
+
+    const char *tooLong = "+USORD: 0,2,\"0A0B\"";
+    const char *empty = "+USORD: 0,0,\"\"";
+    BENCH_CHECK(NBHex::decodeQuoted(tooLong, strlen(tooLong), &byte, 1) == -1);
+    BENCH_CHECK(NBHex::decodeQuoted(empty, strlen(empty), &byte, 1) == 0);
+
+    // a range of segments encodes like the same range of one buffer
+    NBSegment segments[] = {{payload, 5}, {payload + 5, 0}, {payload + 5, 100}, {payload + 105, 407}};
+    static char whole[NB_HEX_LENGTH(sizeof(payload))];
+    BENCH_CHECK(NBHex::length(segments, 4) == sizeof(payload));
+    NBHex::encode(payload, sizeof(payload), whole);
+    BENCH_CHECK(NBHex::encode(segments, 4, 0, sizeof(payload), command) == NB_HEX_LENGTH(sizeof(payload)));
+    BENCH_CHECK(memcmp(command, whole, NB_HEX_LENGTH(sizeof(payload))) == 0);
+    BENCH_CHECK(NBHex::encode(segments, 4, 3, 200, command) == NB_HEX_LENGTH(200));
+    BENCH_CHECK(memcmp(command, whole + NB_HEX_LENGTH(3), NB_HEX_LENGTH(200)) == 0);
+
+    return sink == 0;
+}
@@ -0,0 +1,72 @@
+/*
+  Time the MCU spends awake while the library waits for the modem.
+
+  Runs network registration, PDP attach and a TCP download against the
+  simulated SARA-R4 once with the default wait, which keeps polling the UART,
+  and once with an idle hook that sleeps until the next received byte.
+  Reports virtual time, the part of it the MCU was awake and the number of
+  UART polls that found no data.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void sleepHook(unsigned long maxSleepMs, void *context) {
+    ((FakeSaraR4 *) context)->sleep(maxSleepMs);
+}
+
+static void runSession(bool hook) {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+    NBClient client(modem);
+    std::string body(4096, 'x');
+    std::string received;
+
+    if (hook) {
+        modem.setIdleHook(sleepHook, &sara);
+    }
+
+    BenchTimer timer;
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+    BENCH_CHECK(client.connect("example.org", 80));
+
+    int socket = sara.lastCreatedSocket();
+    sara.peerSend(socket, body, 2000);
+
+    uint8_t buf[128];
+    unsigned long start = millis();
+    while (received.size() < body.size() && millis() - start < 60000) {
+        int n = client.read(buf, sizeof(buf));
+        if (n > 0) {
+            received.append((const char *) buf, n);
+        } else {
+            // the sketch waits for the peer the same way
+            modem.waitForData(100);
+        }
+    }
+    BENCH_CHECK(received == body);
+    client.stop();
+
+    double ms = timer.virtualMillis();
+    double awakeMs = ms - (double) sara.sleptMicros() / 1000.0;
+
+    printf("%-34s %14.1f %14.1f %14lu\n", hook ? "idle hook (sleep until RX)" : "busy wait (no hook)", ms, awakeMs,
+           sara.emptyPolls());
+}
+
+int main() {
+    printf("\n== Idle wait ==\n");
+    printf("%-34s %14s %14s %14s\n", "case", "virtual ms", "awake ms", "empty polls");
+
+    runSession(false);
+    runSession(true);
+
+    return 0;
+}
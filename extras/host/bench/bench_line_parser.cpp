@@ -0,0 +1,303 @@
+/*
+  Modem::poll parser throughput.
+
+  Feeds a recorded-style stream of long +USORD responses, multi-line
+  +COPS/+CMGL responses and URCs through the current Modem::poll and through
+  the previous String based parser, and reports parsed bytes per second and
+  heap allocations made while parsing, also with the stats and trace hooks
+  attached. Checks that a line too long for the line buffer is dropped and
+  counted.
+*/
+
+#include <string>
+#include <vector>
+
+#include <Modem.h>
+
+#include "BenchUtil.h"
+#include "MemorySerial.h"
+
+static unsigned long allocations = 0;
+
+extern "C" void *__real_malloc(size_t size);
+extern "C" void *__real_realloc(void *ptr, size_t size);
+
+extern "C" void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+// The String based Modem::poll this library used before the line buffer
+class LegacyParser {
+public:
+    explicit LegacyParser(Stream &uart) : _uart(&uart), _atCommandState(AT_COMMAND_IDLE), _ready(1),
+                                          _responseDataStorage(nullptr), urcs(0) {
+        _buffer.reserve(64);
+    }
+
+    void send() {
+        _atCommandState = AT_COMMAND_IDLE;
+        _ready = 0;
+    }
+
+    int waitForResponse(String *responseDataStorage) {
+        _responseDataStorage = responseDataStorage;
+        while (_uart->available()) {
+            poll();
+            if (_ready) {
+                break;
+            }
+        }
+        _responseDataStorage = nullptr;
+        return _ready;
+    }
+
+    void poll() {
+        while (_uart->available()) {
+            char c = _uart->read();
+
+            _buffer += c;
+
+            switch (_atCommandState) {
+                case AT_COMMAND_IDLE:
+                default: {
+                    if (_buffer.startsWith("AT") && _buffer.endsWith("\r\n")) {
+                        _atCommandState = AT_RECEIVING_RESPONSE;
+                        _buffer = "";
+                    } else if (_buffer.endsWith("\r\n")) {
+                        _buffer.trim();
+
+                        if (_buffer.length()) {
+                            String urc = _buffer;
+                            urcs++;
+                        }
+
+                        _buffer = "";
+                    }
+
+                    break;
+                }
+
+                case AT_RECEIVING_RESPONSE: {
+                    if (c == '\n') {
+                        int responseResultIndex;
+
+                        if ((responseResultIndex = _buffer.lastIndexOf("OK\r\n")) != -1) {
+                            _ready = 1;
+                        } else if ((responseResultIndex = _buffer.lastIndexOf("ERROR\r\n")) != -1) {
+                            _ready = 2;
+                        } else if ((responseResultIndex = _buffer.lastIndexOf("NO CARRIER\r\n")) != -1) {
+                            _ready = 3;
+                        } else if ((responseResultIndex = _buffer.lastIndexOf("CME ERROR")) != -1) {
+                            _ready = 4;
+                        }
+
+                        if (_ready != 0) {
+                            if (_responseDataStorage != nullptr) {
+                                if (_ready > 1) {
+                                    _buffer.substring(responseResultIndex);
+                                } else {
+                                    _buffer.remove(responseResultIndex);
+                                }
+                                _buffer.trim();
+
+                                *_responseDataStorage = _buffer;
+
+                                _responseDataStorage = nullptr;
+                            }
+
+                            _atCommandState = AT_COMMAND_IDLE;
+                            _buffer = "";
+                            return;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    Stream *_uart;
+    enum {
+        AT_COMMAND_IDLE,
+        AT_RECEIVING_RESPONSE
+    } _atCommandState;
+    int _ready;
+    String _buffer;
+    String *_responseDataStorage;
+
+public:
+    unsigned long urcs;
+};
+
+class CountingUrcHandler : public ModemUrcHandler {
+public:
+    unsigned long count = 0;
+
+    void handleUrc(const char *) override { count++; }
+};
+
+struct Exchange {
+    std::string bytes;
+    std::string expected;
+    int result;
+    int errorCode;
+};
+
+static std::string hexPayload(size_t size) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string hex;
+
+    for (size_t i = 0; i < size; i++) {
+        uint8_t b = (uint8_t) (i * 37 + 11);
+        hex += digits[b >> 4];
+        hex += digits[b & 0x0f];
+    }
+
+    return hex;
+}
+
+static std::vector<Exchange> buildSession() {
+    std::vector<Exchange> session;
+    std::string payload = hexPayload(512);
+    std::string cmgl;
+
+    for (int i = 0; i < 6; i++) {
+        if (!cmgl.empty()) {
+            cmgl += "\r\n";
+        }
+        cmgl += "+CMGL: " + std::to_string(i + 1) + ",\"REC UNREAD\",\"+15550100\",,\"26/10/17,12:00:00+00\"\r\n";
+        cmgl += "status report " + std::to_string(i) + " temperature=21.5 humidity=40";
+    }
+
+    for (int i = 0; i < 16; i++) {
+        std::string usord = "+USORD: 0,512,\"" + payload + "\"";
+
+        session.push_back({"\r\n+UUSORD: 0,512\r\n", "", 0, -1});
+        session.push_back({"AT+USORD=0,512\r\n\r\n" + usord + "\r\n\r\nOK\r\n", usord, 1, -1});
+    }
+
+    session.push_back({"AT+CMGL=\"REC UNREAD\"\r\n\r\n" + cmgl + "\r\n\r\nOK\r\n", cmgl, 1, -1});
+
+    std::string cops = "+COPS: (2,\"Simulated NB\",\"SimNB\",\"00101\",9),(1,\"Other\",\"Oth\",\"00102\",8),,(0,1,2,3,4),(0,1,2)";
+    session.push_back({"AT+COPS=?\r\n\r\n" + cops + "\r\n\r\nOK\r\n", cops, 1, -1});
+    session.push_back({"AT+CEREG?\r\n\r\n+CEREG: 0,1\r\n\r\nOK\r\n", "+CEREG: 0,1", 1, -1});
+    session.push_back({"AT+USOCO=0,\"10.0.0.1\",80\r\n\r\n+CME ERROR: Operation not allowed\r\n",
+                       "+CME ERROR: Operation not allowed", 4, 3});
+
+    return session;
+}
+
+static void parse(MemorySerial &serial, const std::vector<Exchange> &session, int rounds, size_t sessionBytes,
+                  bool hooks, const char *name) {
+    Modem modem(serial, 115200, 255, 5);
+    CountingUrcHandler urcs;
+    ModemStats stats;
+    static uint8_t traceBuffer[4096];
+    ModemRingTrace trace(traceBuffer, sizeof(traceBuffer));
+    String response;
+    unsigned long responses = 0;
+
+    modem.addUrcHandler(&urcs);
+    if (hooks) {
+        modem.setStats(&stats);
+        modem.setTrace(&trace);
+    }
+    response.reserve(1100);
+
+    allocations = 0;
+    BenchTimer timer;
+    for (int r = 0; r < rounds; r++) {
+        for (auto const &exchange : session) {
+            serial.load(exchange.bytes);
+            if (exchange.expected.empty()) {
+                modem.poll();
+            } else {
+                modem.send("");
+                BENCH_CHECK(modem.waitForResponse(1000, &response) == exchange.result);
+                BENCH_CHECK(modem.lastErrorCode() == exchange.errorCode);
+                BENCH_CHECK(exchange.expected == response.c_str());
+                responses++;
+            }
+        }
+    }
+    double us = timer.wallMicros();
+    double bytes = (double) sessionBytes * rounds;
+
+    BENCH_CHECK(urcs.count == 16UL * rounds);
+    BENCH_CHECK(!hooks || stats.bytesReceived() == bytes);
+    printf("%-26s %14.1f %14.2f %16.1f\n", name, bytes / us, us * 1000.0 / bytes, (double) allocations / responses);
+}
+
+int main() {
+    const int rounds = 50;
+    std::vector<Exchange> session = buildSession();
+    size_t sessionBytes = 0;
+
+    for (auto const &exchange : session) {
+        sessionBytes += exchange.bytes.size();
+    }
+
+    printf("\n== Modem::poll parser ==\n");
+    printf("%-26s %14s %14s %16s\n", "parser", "MB/s", "ns/byte", "allocs/response");
+
+    MemorySerial serial;
+
+    {
+        LegacyParser parser(serial);
+        String response;
+        unsigned long responses = 0;
+
+        allocations = 0;
+        BenchTimer timer;
+        for (int r = 0; r < rounds; r++) {
+            for (auto const &exchange : session) {
+                serial.load(exchange.bytes);
+                if (exchange.expected.empty()) {
+                    parser.poll();
+                } else {
+                    parser.send();
+                    BENCH_CHECK(parser.waitForResponse(&response) == exchange.result);
+                    BENCH_CHECK(exchange.expected == response.c_str());
+                    responses++;
+                }
+            }
+        }
+        double us = timer.wallMicros();
+        double bytes = (double) sessionBytes * rounds;
+
+        printf("%-26s %14.1f %14.2f %16.1f\n", "String (previous)", bytes / us, us * 1000.0 / bytes,
+               (double) allocations / responses);
+    }
+
+    parse(serial, session, rounds, sessionBytes, false, "ModemLineBuffer");
+    parse(serial, session, rounds, sessionBytes, true, "ModemLineBuffer + hooks");
+
+    // a line too long for the buffer is dropped, not handed on truncated
+    {
+        Modem modem(serial, 115200, 255, 5);
+        ModemStats stats;
+        CountingUrcHandler urcs;
+        String response;
+
+        modem.setStats(&stats);
+        modem.addUrcHandler(&urcs);
+
+        serial.load("\r\n+UUSORD: " + std::string(MODEM_LINE_BUFFER_SIZE, '1') + "\r\n");
+        modem.poll();
+        BENCH_CHECK(urcs.count == 0 && stats.overflows() == 1);
+
+        serial.load("AT+USORD=0,600\r\n\r\n+USORD: 0,600,\"" + std::string(1200, 'A') + "\"\r\n\r\nOK\r\n");
+        modem.send("");
+        BENCH_CHECK(modem.waitForResponse(1000, &response) == MODEM_RESULT_OK);
+        BENCH_CHECK(response.length() == 0 && stats.overflows() == 2);
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+  Scatter-gather writes against the simulated SARA-R4.
+
+  Sends MQTT style messages made of a fixed header, a topic and a body held
+  in separate buffers: copied together into one buffer first, written with
+  one write() per buffer, and written with a single write() of segments.
+  Then sends UDP datagrams built the same way with write() per buffer and
+  with endPacket(segments). Reports the AT commands and the virtual time.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+enum Mode {
+    COPY,
+    WRITE_EACH,
+    SEGMENTS
+};
+
+static void publish(Modem &modem, FakeSaraR4 &sara, size_t bodySize, Mode mode, const char *name) {
+    NBClient client(modem);
+    std::string header = benchPattern(5, 1);
+    std::string topic = "sensors/field-7/telemetry/raw";
+    std::string body = benchPattern(bodySize, 3);
+    std::string message = header + topic + body;
+    const int messages = 10;
+
+    BENCH_CHECK(client.connect("example.org", 1883));
+    int socket = sara.lastCreatedSocket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    for (int i = 0; i < messages; i++) {
+        if (mode == COPY) {
+            std::string joined = header + topic + body;
+            client.write((const uint8_t *) joined.data(), joined.size());
+        } else if (mode == WRITE_EACH) {
+            client.write((const uint8_t *) header.data(), header.size());
+            client.write((const uint8_t *) topic.data(), topic.size());
+            client.write((const uint8_t *) body.data(), body.size());
+        } else {
+            NBSegment segments[] = {
+                    {(const uint8_t *) header.data(), header.size()},
+                    {(const uint8_t *) topic.data(), topic.size()},
+                    {(const uint8_t *) body.data(), body.size()},
+            };
+            BENCH_CHECK(client.write(segments, 3) == message.size());
+        }
+        client.flush();
+    }
+    double ms = timer.virtualMillis();
+
+    std::string expected;
+    for (int i = 0; i < messages; i++) {
+        expected += message;
+    }
+    BENCH_CHECK(sara.peerReceived(socket) == expected);
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+
+    client.stop();
+}
+
+static void datagrams(Modem &modem, FakeSaraR4 &sara, bool segments, const char *name) {
+    NBUDP udp(modem);
+    std::string header = benchPattern(12, 5);
+    std::string body = benchPattern(400, 7);
+    const int packets = 10;
+
+    BENCH_CHECK(udp.begin(5000));
+
+    sara.clearLog();
+    BenchTimer timer;
+    for (int i = 0; i < packets; i++) {
+        BENCH_CHECK(udp.beginPacket("192.0.2.1", 7));
+        udp.write((const uint8_t *) header.data(), header.size());
+
+        if (segments) {
+            NBSegment segment = {(const uint8_t *) body.data(), body.size()};
+            BENCH_CHECK(udp.endPacket(&segment, 1));
+        } else {
+            udp.write((const uint8_t *) body.data(), body.size());
+            BENCH_CHECK(udp.endPacket());
+        }
+    }
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(sara.datagramsSent().size() >= (size_t) packets);
+    BENCH_CHECK(sara.datagramsSent().back().data == header + body);
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+
+    // a datagram larger than the packet buffer is refused
+    std::string large = benchPattern(512, 9);
+    NBSegment segment = {(const uint8_t *) large.data(), large.size()};
+    BENCH_CHECK(udp.beginPacket("192.0.2.1", 7));
+    udp.write((const uint8_t *) header.data(), header.size());
+    BENCH_CHECK(udp.endPacket(&segment, 1) == 0);
+
+    udp.stop();
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+    const size_t bodySizes[] = {64, 1500};
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    for (size_t bodySize : bodySizes) {
+        char title[64];
+
+        snprintf(title, sizeof(title), "TCP, 10 messages, %zu B body", bodySize);
+        benchHeader(title);
+        publish(modem, sara, bodySize, COPY, "copied into one buffer");
+        publish(modem, sara, bodySize, WRITE_EACH, "write() per buffer");
+        publish(modem, sara, bodySize, SEGMENTS, "write(segments)");
+    }
+
+    benchHeader("UDP, 10 datagrams, 412 B");
+    datagrams(modem, sara, false, "write() per buffer");
+    datagrams(modem, sara, true, "endPacket(segments)");
+
+    return 0;
+}
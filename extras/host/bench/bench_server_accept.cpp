@@ -0,0 +1,152 @@
+/*
+  TCP server accepting connections from +UUSOLI.
+
+  Three peers connect to an NBServer on the simulated SARA-R4 within a few
+  milliseconds of each other, each sending a request line. A sketch loop
+  doing 5 ms of its own work takes the accepted clients from available(),
+  answers them and stops them. Reports the time until all peers got their
+  answer and the AT commands it took, and checks that waiting for
+  connections sends no AT commands and that connections beyond the backlog,
+  also with a full command queue, and those left at stop() are closed. Also
+  checks that a client can be assigned from available() and that one the
+  peer closed before it was handed out reports itself closed.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const int NUM_PEERS = 3;
+
+static void serve(Modem &modem, FakeSaraR4 &sara, NBServer &server) {
+    int listening = sara.lastCreatedSocket();
+    int answered = 0;
+    int sockets[NUM_PEERS];
+
+    for (int i = 0; i < NUM_PEERS; i++) {
+        sara.peerConnect(listening, "192.0.2.10", (uint16_t) (40000 + i), 10 + i * 2);
+    }
+
+    sara.clearLog();
+    BenchTimer timer;
+    while (answered < NUM_PEERS && timer.virtualMillis() < 5000) {
+        NBClient client = server.available();
+
+        if (client) {
+            char line[32];
+
+            sara.peerSend(client.socket(), "GET " + std::to_string(answered) + "\n", 5);
+            client.setTimeout(1000);
+            int length = client.readBytesUntil('\n', line, sizeof(line) - 1);
+            BENCH_CHECK(length > 0);
+            line[length] = '\0';
+
+            client.print("OK ");
+            client.print(line);
+            client.flush();
+            sockets[answered++] = client.socket();
+            BENCH_CHECK(sara.peerReceived(client.socket()) == std::string("OK ") + line);
+            client.stop();
+        }
+
+        modem.poll();
+        // the sketch's own work
+        delay(5);
+    }
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(answered == NUM_PEERS);
+    BENCH_CHECK(sockets[0] != sockets[1] && sockets[1] != sockets[2] && sockets[0] != listening);
+
+    benchRow("3 peers, 5 ms loop", ms, timer.wallMicros(), sara.commandCount());
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+    NBServer server(modem, 2000);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    server.begin();
+    BENCH_CHECK(server.listening());
+    int listening = sara.lastCreatedSocket();
+
+    // waiting for connections sends no AT commands
+    sara.clearLog();
+    for (int i = 0; i < 100; i++) {
+        BENCH_CHECK(!server.available());
+        delay(5);
+    }
+    BENCH_CHECK(sara.commandCount() == 0);
+
+    benchHeader("Server accept");
+    serve(modem, sara, server);
+
+    // more connections than the backlog holds, the extra ones are closed even with a full queue
+    while (modem.queued() > 0) {
+        modem.waitForData(100);
+        modem.poll();
+    }
+    for (int i = 0; i < NB_SERVER_BACKLOG + 1; i++) {
+        sara.peerConnect(listening, "192.0.2.11", (uint16_t) (41000 + i), 1);
+    }
+    for (int i = 0; i < MODEM_COMMAND_QUEUE_SIZE; i++) {
+        BENCH_CHECK(modem.enqueue("AT+CSQ", 1000));
+    }
+    delay(50);
+    modem.poll();
+    BENCH_CHECK(server.accepted() == NB_SERVER_BACKLOG);
+    BENCH_CHECK(modem.sockets().closeQueued());
+    modem.sockets().waitForClose();
+    int open = 0;
+    for (int s = 0; s < FakeSaraR4::NUM_SOCKETS; s++) {
+        open += sara.socketOpen(s) ? 1 : 0;
+    }
+    BENCH_CHECK(open == 1 + NB_SERVER_BACKLOG);
+
+    // stop() closes the listening socket and the connections not handed out
+    server.stop();
+    BENCH_CHECK(!server.listening() && server.accepted() == 0);
+    modem.sockets().waitForClose();
+    for (int s = 0; s < FakeSaraR4::NUM_SOCKETS; s++) {
+        BENCH_CHECK(!sara.socketOpen(s));
+    }
+
+    // a client handed out by a server that is gone still works, also when assigned
+    server.begin();
+    listening = sara.lastCreatedSocket();
+    sara.peerConnect(listening, "192.0.2.12", 42000, 1);
+    delay(50);
+    NBClient client(modem);
+    client = server.available();
+    BENCH_CHECK(client && client.connected());
+
+    // a connection the peer closed before it was handed out
+    sara.peerConnect(listening, "192.0.2.13", 43000, 1);
+    delay(50);
+    modem.poll();
+    BENCH_CHECK(server.accepted() == 1);
+    for (int s = 0; s < FakeSaraR4::NUM_SOCKETS; s++) {
+        if (s != listening && s != client.socket() && sara.socketOpen(s)) {
+            sara.peerClose(s, 1);
+        }
+    }
+    delay(50);
+    modem.poll();
+    NBClient closed = server.available();
+    BENCH_CHECK(closed && !closed.connected());
+    server.stop();
+    sara.peerSend(client.socket(), "bye", 1);
+    delay(50);
+    BENCH_CHECK(client.available() == 3);
+    client.stop();
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+  Socket close in the background.
+
+  Opens three TCP clients and a UDP socket on the simulated SARA-R4, with the
+  module taking 1.5 s to close a TCP connection, and stops them all from a
+  sketch loop that does 5 ms of its own work and polls the modem. Reports the
+  time the stop() calls held up the sketch and the time until the module
+  closed every socket, with the normal queued close and with the fast close
+  of TCP sockets. Then checks that a socket stopped while a read is queued
+  and a new connect right after a stop both work.
+*/
+
+#include <algorithm>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const int NUM_CLIENTS = 3;
+
+static bool closing(Modem &modem, const int *sockets, int count) {
+    for (int i = 0; i < count; i++) {
+        if (modem.sockets().closing(sockets[i])) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void run(Modem &modem, FakeSaraR4 &sara, bool fast, const char *name) {
+    NBClient clients[NUM_CLIENTS] = {NBClient(modem), NBClient(modem), NBClient(modem)};
+    NBUDP udp(modem);
+    int sockets[NUM_CLIENTS + 1];
+
+    for (int i = 0; i < NUM_CLIENTS; i++) {
+        BENCH_CHECK(clients[i].connect("example.org", 80));
+        clients[i].setFastClose(fast);
+        sockets[i] = clients[i].socket();
+    }
+    BENCH_CHECK(udp.begin(5000));
+    sockets[NUM_CLIENTS] = udp.socket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    for (int i = 0; i < NUM_CLIENTS; i++) {
+        clients[i].stop();
+    }
+    udp.stop();
+    double stopMs = timer.virtualMillis();
+
+    double longestMs = 0;
+    while (closing(modem, sockets, NUM_CLIENTS + 1) && timer.virtualMillis() < 20000) {
+        BenchTimer iteration;
+
+        modem.poll();
+        // the sketch's own work
+        delay(5);
+
+        longestMs = std::max(longestMs, iteration.virtualMillis());
+    }
+    double ms = timer.virtualMillis();
+
+    for (int socket : sockets) {
+        BENCH_CHECK(!modem.sockets().closing(socket));
+        BENCH_CHECK(!sara.socketOpen(socket));
+    }
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14.1f\n", "  stop() calls ms", stopMs);
+    printf("%-34s %14.1f\n", "  longest loop ms", std::max(stopMs, longestMs));
+}
+
+static void reconnect(Modem &modem, FakeSaraR4 &sara) {
+    NBClient client(modem);
+    NBClient next(modem);
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    int socket = client.socket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    client.stop();
+    // AT+USOCR waits for the queued AT+USOCL
+    BENCH_CHECK(next.connect("example.org", 80));
+    BENCH_CHECK(!sara.socketOpen(socket) || next.socket() == socket);
+
+    benchRow("connect() right after stop()", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    next.stop();
+}
+
+static void reuse(Modem &modem, FakeSaraR4 &sara) {
+    NBClient client(modem);
+    NBClient next(modem);
+    uint8_t buf[64];
+
+    // stopped with unread data and a read in flight
+    BENCH_CHECK(client.connect("example.org", 80));
+    sara.peerSend(client.socket(), std::string(600, 'd'), 10);
+    delay(50);
+    BENCH_CHECK(client.read(buf, sizeof(buf)) > 0);
+    int socket = client.socket();
+    client.setFastClose(true);
+    client.stop();
+    BENCH_CHECK(modem.sockets().closing(socket));
+
+    // the next connect gets another socket while the first one closes
+    BENCH_CHECK(next.connect("example.org", 80));
+    BENCH_CHECK(next.socket() != socket);
+    next.print("hello");
+    next.flush();
+    BENCH_CHECK(!next.getWriteError());
+
+    unsigned long start = millis();
+    while (modem.sockets().closing(socket) && millis() - start < 5000) {
+        modem.poll();
+        modem.waitForData(100);
+    }
+    BENCH_CHECK(!modem.sockets().closing(socket) && !sara.socketOpen(socket));
+    BENCH_CHECK(next.connected());
+
+    // a UDP socket falls back to the normal close
+    NBUDP udp(modem);
+    BENCH_CHECK(udp.begin(5000));
+    socket = udp.socket();
+    udp.stop();
+    while (modem.sockets().closing(socket) && millis() - start < 10000) {
+        modem.poll();
+        modem.waitForData(100);
+    }
+    BENCH_CHECK(!sara.socketOpen(socket));
+
+    next.stop();
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    // the module waits for the peer to acknowledge the closure
+    sara.setLatency("AT+USOCL", 1500);
+
+    benchHeader("Socket close");
+    run(modem, sara, false, "stop(), queued close");
+    run(modem, sara, true, "stop(), fast close");
+    reconnect(modem, sara);
+
+    reuse(modem, sara);
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+  Socket options queued as AT+USOSO.
+
+  Connects to the simulated SARA-R4 with keepalive, a keepalive idle time,
+  no Nagle, linger and a type of service set beforehand, with connect() and
+  with connectAsync() from a sketch loop doing 5 ms of its own work. Reports
+  the connect time and AT commands next to a connect without options, and
+  checks that the options were sent before either connect returned or called
+  back, through the AT+USOGO getters that every option reached the socket,
+  that options set while connected do too and that a reconnect sets them
+  again.
+*/
+
+#include <algorithm>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void setOptions(NBClient &client) {
+    client.setKeepAlive(true, 30000);
+    client.setNoDelay(true);
+    client.setLinger(true, 2000);
+    client.setTos(0x10);
+}
+
+static void checkOptions(NBClient &client) {
+    unsigned long idle = 0;
+    unsigned long linger = 0;
+
+    BENCH_CHECK(client.getKeepAlive(&idle) == 1 && idle == 30000);
+    BENCH_CHECK(client.getNoDelay() == 1);
+    BENCH_CHECK(client.getLinger(&linger) == 1 && linger == 2000);
+    BENCH_CHECK(client.getTos() == 0x10);
+}
+
+struct OptionsConnect {
+    FakeSaraR4 *sara;
+    BenchConnect run;
+    unsigned long options;
+};
+
+static void optionsConnected(int result, void *context) {
+    OptionsConnect *connect = (OptionsConnect *) context;
+
+    // the options were sent before the connect reported
+    connect->options = connect->sara->commandCount("AT+USOSO");
+    benchConnected(result, &connect->run);
+}
+
+static void blocking(Modem &modem, FakeSaraR4 &sara, bool options, const char *name) {
+    NBClient client(modem);
+
+    if (options) {
+        setOptions(client);
+    }
+
+    modem.sockets().waitForClose();
+    sara.clearLog();
+    BenchTimer timer;
+    BENCH_CHECK(client.connect("example.org", 80));
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(sara.commandCount("AT+USOSO") == (options ? 5UL : 0UL));
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+
+    if (options) {
+        checkOptions(client);
+    } else {
+        BENCH_CHECK(client.getNoDelay() == 0);
+    }
+
+    client.stop();
+}
+
+static void async(Modem &modem, FakeSaraR4 &sara) {
+    NBClient client(modem);
+    OptionsConnect connect = {&sara, {false, -1}, 0};
+    BenchConnect &run = connect.run;
+    double longestMs = 0;
+
+    setOptions(client);
+
+    modem.sockets().waitForClose();
+    sara.clearLog();
+    BenchTimer timer;
+    BENCH_CHECK(client.connectAsync("example.org", 80, optionsConnected, &connect));
+    while (!run.done && timer.virtualMillis() < 5000) {
+        BenchTimer iteration;
+
+        modem.poll();
+        // the sketch's own work
+        delay(5);
+
+        longestMs = std::max(longestMs, iteration.virtualMillis());
+    }
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(run.result == NB_CONNECT_OK && client.connected());
+    BENCH_CHECK(connect.options == 5);
+    benchRow("connectAsync() with options", ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14.1f\n", "  longest loop ms", longestMs);
+
+    checkOptions(client);
+
+    // changed while connected
+    client.setNoDelay(false);
+    client.setTos(0);
+    BENCH_CHECK(client.getNoDelay() == 0 && client.getTos() == 0);
+
+    // a reconnect sets them all again
+    client.stop();
+    sara.clearLog();
+    BENCH_CHECK(client.connect("example.org", 80));
+    BENCH_CHECK(client.getNoDelay() == 0 && client.getKeepAlive() == 1);
+    BENCH_CHECK(sara.commandCount("AT+USOSO") == 5);
+    client.stop();
+
+    // no socket, no options to read
+    BENCH_CHECK(client.getNoDelay() == -1);
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    benchHeader("Socket options");
+    blocking(modem, sara, false, "connect()");
+    blocking(modem, sara, true, "connect() with options");
+    async(modem, sara);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+  Parsing received data in place against the simulated SARA-R4.
+
+  Receives an HTTP response header of 16 lines and splits it into lines,
+  once the whole header is in the receive buffer: byte by byte with read(),
+  with Stream::readBytesUntil() (one timedRead() per byte), with the
+  memchr based NBClient::readBytesUntil(), and by scanning peekSpan()
+  without copying. Reports the host time the parsing takes per header.
+*/
+
+#include <string.h>
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+enum Mode {
+    READ_BYTES,
+    STREAM_UNTIL,
+    CLIENT_UNTIL,
+    PEEK_SPAN
+};
+
+static std::string header() {
+    std::string text = "HTTP/1.1 200 OK\r\n";
+
+    for (int i = 0; i < 14; i++) {
+        text += "X-Header-" + std::to_string(i) + ": a value of typical length " + std::to_string(i * 7) + "\r\n";
+    }
+
+    return text + "\r\n";
+}
+
+// Length of the next line without its newline, -1 if there is none
+static int nextLine(NBClient &client, Mode mode, std::string &lines) {
+    char line[128];
+    int n = 0;
+
+    if (mode == READ_BYTES) {
+        int c;
+        while ((c = client.read()) >= 0 && c != '\n' && n < (int) sizeof(line)) {
+            line[n++] = (char) c;
+        }
+        if (c < 0) {
+            return -1;
+        }
+    } else if (mode == STREAM_UNTIL) {
+        n = (int) static_cast<Stream &>(client).readBytesUntil('\n', line, sizeof(line));
+    } else if (mode == CLIENT_UNTIL) {
+        n = (int) client.readBytesUntil('\n', line, sizeof(line));
+    } else {
+        // scan the receive buffer, the bytes are only copied to keep them for the check
+        const uint8_t *data;
+        size_t span;
+
+        while ((span = client.peekSpan(&data)) > 0) {
+            const uint8_t *end = (const uint8_t *) memchr(data, '\n', span);
+            size_t part = end != NULL ? (size_t) (end - data) : span;
+
+            lines.append((const char *) data, part);
+            n += (int) part;
+            client.consume(end != NULL ? part + 1 : part);
+
+            if (end != NULL) {
+                lines += '\n';
+                return n;
+            }
+        }
+
+        return -1;
+    }
+
+    lines.append(line, n);
+    lines += '\n';
+
+    return n;
+}
+
+static int parse(NBClient &client, Mode mode, std::string &lines) {
+    int count = 0;
+    int n;
+
+    // the empty line ends the header
+    while ((n = nextLine(client, mode, lines)) >= 0) {
+        count++;
+
+        if (n <= 1) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+static double run(Modem &modem, FakeSaraR4 &sara, Mode mode, const std::string &text, const char *name) {
+    const int repeat = 100;
+    double parseUs = 0;
+
+    for (int r = 0; r < repeat; r++) {
+        NBClient client(modem);
+        std::string lines;
+
+        BENCH_CHECK(client.connect("example.org", 80));
+        sara.peerSend(sara.lastCreatedSocket(), text, 10);
+        client.setTimeout(100);
+
+        // everything buffered, only the parsing is timed
+        unsigned long start = millis();
+        while (client.available() < (int) text.size() && millis() - start < 5000) {
+            modem.waitForData(10);
+        }
+        BENCH_CHECK(client.available() == (int) text.size());
+
+        BenchTimer timer;
+        int count = parse(client, mode, lines);
+        parseUs += timer.wallMicros();
+
+        BENCH_CHECK(count == 16);
+        BENCH_CHECK(lines == text);
+
+        client.stop();
+    }
+
+    printf("%-34s %14.2f\n", name, parseUs / repeat);
+
+    return parseUs / repeat;
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+    std::string text = header();
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+    BENCH_CHECK(text.size() <= NB_SOCKET_BUFFER_SIZE);
+
+    printf("\n== Header parsing, %zu B in 16 lines ==\n", text.size());
+    printf("%-34s %14s\n", "case", "host us");
+    run(modem, sara, READ_BYTES, text, "read() per byte");
+    run(modem, sara, STREAM_UNTIL, text, "Stream::readBytesUntil()");
+    run(modem, sara, CLIENT_UNTIL, text, "NBClient::readBytesUntil()");
+    run(modem, sara, PEEK_SPAN, text, "peekSpan() + consume()");
+
+    return 0;
+}
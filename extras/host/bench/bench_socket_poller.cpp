@@ -0,0 +1,218 @@
+/*
+  Waiting on several sockets against the simulated SARA-R4.
+
+  Three TCP clients and a UDP socket receive messages at spread out times
+  over 10 s, and one of the servers closes its connection. A sketch loop
+  either checks connected() and available()/parsePacket() on each socket in
+  turn every 10 ms, or waits on an NBSocketPoller. Reports the AT commands,
+  the loop passes and the mean time from a message arriving to the sketch
+  reading it.
+*/
+
+#include <stdlib.h>
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const int NUM_CLIENTS = 3;
+static const int MESSAGES = 5;
+
+struct Session {
+    NBClient clients[NUM_CLIENTS];
+    NBUDP udp;
+    int sockets[NUM_CLIENTS + 1];
+    unsigned long sentAt[NUM_CLIENTS + 1][MESSAGES];
+    int received[NUM_CLIENTS + 1];
+    std::string data[NUM_CLIENTS + 1];
+    bool closedSeen;
+    double latencyMs;
+    unsigned long passes;
+
+    explicit Session(Modem &modem) :
+            clients{NBClient(modem), NBClient(modem), NBClient(modem)},
+            udp(modem),
+            received{},
+            closedSeen(false),
+            latencyMs(0),
+            passes(0) {}
+};
+
+static void schedule(FakeSaraR4 &sara, Session &session) {
+    unsigned long now = millis();
+
+    for (int s = 0; s <= NUM_CLIENTS; s++) {
+        for (int m = 0; m < MESSAGES; m++) {
+            unsigned long delayMs = 300 + (unsigned long) (s * 517 + m * 1931) % 9000;
+            std::string message = "message " + std::to_string(s) + "." + std::to_string(m) + "\n";
+
+            session.sentAt[s][m] = now + delayMs;
+            if (s < NUM_CLIENTS) {
+                sara.peerSend(session.sockets[s], message, delayMs);
+            } else {
+                sara.peerSendFrom(session.sockets[s], "192.0.2.1", 7, message, delayMs);
+            }
+        }
+    }
+
+    sara.peerClose(session.sockets[1], 9800);
+}
+
+static void receive(Session &session, int s) {
+    uint8_t buf[64];
+    int n;
+
+    if (s < NUM_CLIENTS) {
+        n = session.clients[s].read(buf, sizeof(buf));
+    } else {
+        n = session.udp.parsePacket() ? session.udp.read(buf, sizeof(buf)) : 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        session.data[s] += (char) buf[i];
+
+        // "message <socket>.<message>\n"
+        if (buf[i] == '\n') {
+            size_t dot = session.data[s].rfind('.');
+            int m = atoi(session.data[s].c_str() + dot + 1);
+
+            session.latencyMs += (double) (millis() - session.sentAt[s][m]);
+            session.received[s]++;
+        }
+    }
+}
+
+static void connect(Session &session, FakeSaraR4 &sara) {
+    for (int s = 0; s < NUM_CLIENTS; s++) {
+        BENCH_CHECK(session.clients[s].connect("example.org", 8000 + s));
+        session.sockets[s] = sara.lastCreatedSocket();
+    }
+
+    BENCH_CHECK(session.udp.begin(5000));
+    session.sockets[NUM_CLIENTS] = sara.lastCreatedSocket();
+}
+
+static void report(FakeSaraR4 &sara, Session &session, BenchTimer &timer, const char *name) {
+    for (int s = 0; s <= NUM_CLIENTS; s++) {
+        BENCH_CHECK(session.received[s] == MESSAGES);
+    }
+    BENCH_CHECK(session.closedSeen);
+
+    benchRow(name, timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14lu\n", "  loop passes", session.passes);
+    printf("%-34s %14.1f\n", "  mean read latency ms", session.latencyMs / ((NUM_CLIENTS + 1) * MESSAGES));
+}
+
+static bool done(Session &session) {
+    for (int s = 0; s <= NUM_CLIENTS; s++) {
+        if (session.received[s] < MESSAGES) {
+            return false;
+        }
+    }
+
+    return session.closedSeen;
+}
+
+static void roundRobin(Modem &modem, FakeSaraR4 &sara) {
+    Session session(modem);
+
+    connect(session, sara);
+    sara.clearLog();
+    BenchTimer timer;
+    schedule(sara, session);
+
+    unsigned long start = millis();
+    while (!done(session) && millis() - start < 20000) {
+        for (int s = 0; s < NUM_CLIENTS; s++) {
+            if (session.clients[s].socket() >= 0 && !session.clients[s].connected()) {
+                session.closedSeen = true;
+            }
+
+            while (session.clients[s].available()) {
+                receive(session, s);
+            }
+        }
+        receive(session, NUM_CLIENTS);
+
+        session.passes++;
+        delay(10);
+    }
+
+    report(sara, session, timer, "available() per socket, 10 ms");
+}
+
+static void poller(Modem &modem, FakeSaraR4 &sara) {
+    Session session(modem);
+    NBSocketPoller poller(modem);
+
+    connect(session, sara);
+    for (int s = 0; s < NUM_CLIENTS; s++) {
+        BENCH_CHECK(poller.add(session.clients[s]));
+    }
+    BENCH_CHECK(poller.add(session.udp));
+    BENCH_CHECK(!poller.add(session.clients[0]) && !poller.add(session.udp));
+
+    sara.clearLog();
+    BenchTimer timer;
+    schedule(sara, session);
+
+    unsigned long start = millis();
+    while (!done(session) && millis() - start < 20000) {
+        session.passes++;
+
+        if (poller.poll(1000) == 0) {
+            continue;
+        }
+
+        for (int s = 0; s < NUM_CLIENTS; s++) {
+            int events = poller.events(session.clients[s]);
+
+            if (events & NB_POLL_READABLE) {
+                while (session.clients[s].available()) {
+                    receive(session, s);
+                }
+            }
+
+            if ((events & NB_POLL_CLOSED) && session.clients[s].socket() >= 0) {
+                session.closedSeen = true;
+                session.clients[s].stop();
+            }
+        }
+
+        if (poller.events(session.udp) & NB_POLL_READABLE) {
+            receive(session, NUM_CLIENTS);
+        }
+    }
+
+    report(sara, session, timer, "NBSocketPoller, 1 s timeout");
+
+    // nothing happens, the wait sends no AT commands and returns on time
+    modem.sockets().waitForClose();
+    sara.clearLog();
+    BenchTimer idle;
+    for (int s = 0; s < NUM_CLIENTS; s++) {
+        poller.remove(session.clients[s]);
+    }
+    BENCH_CHECK(poller.poll(500) == 0);
+    BENCH_CHECK(sara.commandCount() == 0);
+    BENCH_CHECK(idle.virtualMillis() >= 499 && idle.virtualMillis() < 520);
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    benchHeader("Socket readiness, 3 TCP + 1 UDP");
+    roundRobin(modem, sara);
+    poller(modem, sara);
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+  Socket buffer pool occupancy.
+
+  Clients connect, receive a response and disconnect over and over, with one
+  to three of them open at the same time, first with the static pool and
+  then with a caller supplied arena of three blocks. Reports the pool size,
+  its peak occupancy and the socket buffers that still came from the heap.
+  Then checks that UDP datagrams are received into a pool block too.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+#include <utility/NBSocketPool.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void exchange(FakeSaraR4 &sara, NBClient *clients, int count) {
+    std::string body(300, 'p');
+    int sockets[3];
+
+    for (int c = 0; c < count; c++) {
+        BENCH_CHECK(clients[c].connect("example.org", 80));
+        sockets[c] = sara.lastCreatedSocket();
+        sara.peerSend(sockets[c], body, 20);
+    }
+
+    for (int c = 0; c < count; c++) {
+        std::string received;
+        uint8_t buf[128];
+        unsigned long start = millis();
+
+        while (received.size() < body.size() && millis() - start < 5000) {
+            int n = clients[c].read(buf, sizeof(buf));
+            if (n > 0) {
+                received.append((const char *) buf, n);
+            }
+        }
+        BENCH_CHECK(received == body);
+    }
+
+    for (int c = 0; c < count; c++) {
+        clients[c].stop();
+    }
+}
+
+static void run(const char *pool, FakeSaraR4 &sara, Modem &modem) {
+    NBClient clients[3] = {NBClient(modem), NBClient(modem), NBClient(modem)};
+
+    for (int count = 1; count <= 3; count++) {
+        unsigned long heap = NBSocketPool::heapAllocations();
+
+        NBSocketPool::resetPeak();
+        for (int cycle = 0; cycle < 20; cycle++) {
+            exchange(sara, clients, count);
+        }
+        BENCH_CHECK(NBSocketPool::used() == 0);
+
+        printf("%-14s %8d %8d %8d %14lu\n", pool, count, NBSocketPool::blocks(), NBSocketPool::peak(),
+               NBSocketPool::heapAllocations() - heap);
+    }
+}
+
+static void datagrams(FakeSaraR4 &sara, Modem &modem) {
+    NBUDP udp(modem);
+    std::string first(200, 'a');
+    std::string second(40, 'b');
+    uint8_t buf[256];
+
+    BENCH_CHECK(udp.begin(5000));
+    sara.peerSendFrom(udp.socket(), "192.0.2.20", 7000, first, 10);
+    delay(50);
+
+    // the datagram goes into a pool block of the socket table, leftovers are dropped by the next one
+    BENCH_CHECK(udp.parsePacket() == (int) first.size());
+    BENCH_CHECK(NBSocketPool::used() == 1);
+    BENCH_CHECK(udp.remoteIP() == IPAddress(192, 0, 2, 20) && udp.remotePort() == 7000);
+    BENCH_CHECK(udp.read(buf, 10) == 10 && udp.available() == (int) first.size() - 10);
+
+    sara.peerSendFrom(udp.socket(), "192.0.2.21", 7001, second, 10);
+    delay(50);
+    BENCH_CHECK(udp.parsePacket() == (int) second.size());
+    BENCH_CHECK(udp.read(buf, sizeof(buf)) == (int) second.size());
+    BENCH_CHECK(second == std::string((const char *) buf, second.size()));
+    BENCH_CHECK(udp.available() == 0 && udp.parsePacket() == 0);
+
+    udp.stop();
+    BENCH_CHECK(NBSocketPool::used() == 0);
+}
+
+int main() {
+    static uint8_t arena[3 * NB_SOCKET_BUFFER_SIZE];
+
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    printf("\n== Socket buffer pool, 20 rounds per row ==\n");
+    printf("%-14s %8s %8s %8s %14s\n", "pool", "clients", "blocks", "peak", "heap buffers");
+
+    run("static", sara, modem);
+
+    BENCH_CHECK(NBSocketPool::setArena(arena, sizeof(arena)));
+    run("arena", sara, modem);
+    BENCH_CHECK(NBSocketPool::setArena(NULL, 0));
+
+    datagrams(sara, modem);
+
+    BENCH_CHECK(NBSocketPool::failures() == 0);
+
+    return 0;
+}
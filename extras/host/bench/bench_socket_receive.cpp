@@ -0,0 +1,164 @@
+/*
+  TCP receive path against the simulated SARA-R4.
+
+  A sketch loop that keeps calling available() on an idle socket, then reads
+  downloads of several sizes, once as fast as possible and once spending
+  10 ms of its own work on every 128 bytes it reads. Reports the AT commands
+  the idle loop costs, the AT+USORD commands each download needs and the
+  payload throughput, also as a share of what the UART can carry as hex.
+  Checks that data announced before the socket closed is still read, also
+  when +UUSOCL arrives before the first read.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void download(Modem &modem, FakeSaraR4 &sara, size_t size, unsigned long workMs) {
+    NBClient client(modem);
+    std::string body = benchPattern(size);
+    std::string received;
+    char name[64];
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    int socket = sara.lastCreatedSocket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    sara.peerSend(socket, body, 50);
+
+    uint8_t buf[128];
+    unsigned long start = millis();
+    while (received.size() < body.size() && millis() - start < 60000) {
+        int n = client.read(buf, sizeof(buf));
+        if (n > 0) {
+            received.append((const char *) buf, n);
+            delay(workMs);
+        }
+    }
+    BENCH_CHECK(received == body);
+
+    // 10 bits per UART byte, 2 hex characters per payload byte
+    double ms = timer.virtualMillis();
+    double lineRate = sara.baud() / 10.0 / 2.0;
+    double rate = size * 1000.0 / ms;
+
+    snprintf(name, sizeof(name), "%zu B download, %lu ms work", size, workMs);
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14lu\n", "  AT+USORD", sara.commandCount("AT+USORD"));
+    printf("%-34s %14.0f %13.0f%%\n", "  payload B/s, of UART hex rate", rate, rate * 100.0 / lineRate);
+
+    client.stop();
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    char title[64];
+    snprintf(title, sizeof(title), "Socket receive, %d B reads", NB_SOCKET_READ_SIZE);
+    benchHeader(title);
+
+    {
+        NBClient client(modem);
+        unsigned long calls = 0;
+
+        BENCH_CHECK(client.connect("example.org", 80));
+
+        sara.clearLog();
+        BenchTimer timer;
+        unsigned long start = millis();
+        while (millis() - start < 1000) {
+            BENCH_CHECK(client.available() == 0);
+            delay(1);
+            calls++;
+        }
+        benchRow("idle available() for 1 s", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+        printf("%-34s %14lu\n", "  available() calls", calls);
+
+        client.stop();
+    }
+
+    {
+        NBClient client(modem);
+        unsigned long calls = 0;
+
+        BENCH_CHECK(client.connect("example.org", 80));
+        int socket = sara.lastCreatedSocket();
+
+        sara.clearLog();
+        BenchTimer timer;
+        unsigned long start = millis();
+        while (millis() - start < 1000) {
+            BENCH_CHECK(client.connected());
+            delay(1);
+            calls++;
+        }
+        benchRow("idle connected() for 1 s", timer.virtualMillis(), timer.wallMicros(), sara.commandCount());
+        printf("%-34s %14lu\n", "  connected() calls", calls);
+
+        // the data sent before the close is still read, then +UUSOCL ends the connection
+        std::string body = "last words";
+        std::string received;
+        sara.peerSend(socket, body, 10);
+        sara.peerClose(socket, 20);
+        start = millis();
+        while (client.connected() && millis() - start < 5000) {
+            uint8_t buf[16];
+            int n = client.read(buf, sizeof(buf));
+            if (n > 0) {
+                received.append((const char *) buf, n);
+            }
+        }
+        BENCH_CHECK(received == body);
+        BENCH_CHECK(!client.connected() && sara.commandCount("AT+USORD") == 1);
+    }
+
+    {
+        NBClient client(modem);
+
+        BENCH_CHECK(client.connect("example.org", 80));
+        int socket = sara.lastCreatedSocket();
+
+        // +UUSORD and then +UUSOCL arrive before the sketch reads anything
+        std::string body = benchPattern(3000);
+        std::string received;
+        sara.peerSend(socket, body, 10);
+        sara.peerCloseUnread(socket, 20);
+        unsigned long start = millis();
+        while (millis() - start < 100) {
+            modem.poll();
+            delay(1);
+        }
+        BENCH_CHECK(modem.sockets().closed(socket) && client.connected());
+
+        start = millis();
+        while (client.connected() && millis() - start < 5000) {
+            uint8_t buf[256];
+            int n = client.read(buf, sizeof(buf));
+            if (n > 0) {
+                received.append((const char *) buf, n);
+            }
+        }
+        BENCH_CHECK(received == body);
+        BENCH_CHECK(!client.connected());
+    }
+
+    const size_t sizes[] = {100, 512, 4096, 16384};
+
+    for (unsigned long workMs : {0UL, 10UL}) {
+        for (size_t size : sizes) {
+            download(modem, sara, size, workMs);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*
+  TCP send path against the simulated SARA-R4.
+
+  Uploads payloads of several sizes with a single write() call in sync mode,
+  and in async mode (beginWrite(false)) with write() calls taking a chunk
+  each, and reports the AT+USOWR commands each upload needs, the payload
+  throughput, also as a share of what the UART can carry as hex, and the
+  longest write() call. Then checks that a modem taking only part of a
+  chunk, or refusing it, shows up as a short write and getWriteError().
+
+  Finally uploads over a slow uplink whose modem send buffer fills up: with
+  no send window, with a send window and a sync write, and with a sketch
+  loop writing what availableForWrite() allows, from a sync and from an
+  async client. Reports the bytes that made it, the time and the longest
+  the sketch was blocked in availableForWrite() and write().
+*/
+
+#include <algorithm>
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static void upload(Modem &modem, FakeSaraR4 &sara, size_t size, bool async) {
+    NBClient client(modem);
+    std::string body = benchPattern(size);
+    char name[64];
+    double longestMs = 0;
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    int socket = sara.lastCreatedSocket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    client.beginWrite(!async);
+    if (async) {
+        size_t sent = 0;
+
+        // an async write takes a chunk at a time, the sketch writes the rest once the modem took it
+        while (sent < size && timer.virtualMillis() < 60000) {
+            BenchTimer blocked;
+
+            sent += client.write((const uint8_t *) body.data() + sent, size - sent);
+            longestMs = std::max(longestMs, blocked.virtualMillis());
+
+            if (sent < size) {
+                modem.waitForData(5);
+            }
+        }
+        BENCH_CHECK(sent == size);
+    } else {
+        BENCH_CHECK(client.write((const uint8_t *) body.data(), body.size()) == size);
+        longestMs = timer.virtualMillis();
+    }
+    while (client.ready() == 0) {
+        modem.waitForData(100);
+    }
+    client.endWrite();
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(sara.peerReceived(socket) == body);
+    BENCH_CHECK(!client.getWriteError());
+
+    // 10 bits per UART byte, 2 hex characters per payload byte
+    double lineRate = sara.baud() / 10.0 / 2.0;
+    double rate = size * 1000.0 / ms;
+
+    snprintf(name, sizeof(name), "%zu B upload, %s", size, async ? "async" : "sync");
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14lu\n", "  AT+USOWR", sara.commandCount("AT+USOWR"));
+    printf("%-34s %14.0f %13.0f%%\n", "  payload B/s, of UART hex rate", rate, rate * 100.0 / lineRate);
+    printf("%-34s %14.1f\n", "  longest write() ms", longestMs);
+
+    client.stop();
+}
+
+static void shortWrites(Modem &modem, FakeSaraR4 &sara) {
+    NBClient client(modem);
+    std::string body = benchPattern(4096);
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    int socket = sara.lastCreatedSocket();
+
+    // the modem takes only part of the first chunk
+    sara.setWriteLimit(100);
+    BENCH_CHECK(client.write((const uint8_t *) body.data(), body.size()) == 100);
+    BENCH_CHECK(client.getWriteError());
+    BENCH_CHECK(sara.peerReceived(socket) == body.substr(0, 100));
+    sara.setWriteLimit(0);
+
+    // the rest goes out once the application retries
+    client.clearWriteError();
+    BENCH_CHECK(client.write((const uint8_t *) body.data() + 100, body.size() - 100) == body.size() - 100);
+    BENCH_CHECK(!client.getWriteError());
+    BENCH_CHECK(sara.peerReceived(socket) == body);
+
+    // a refused chunk ends the write after what was acknowledged
+    sara.failNext("AT+USOWR", "ERROR");
+    sara.clearPeerReceived(socket);
+    BENCH_CHECK(client.write((const uint8_t *) body.data(), body.size()) == 0);
+    BENCH_CHECK(client.getWriteError());
+    BENCH_CHECK(sara.peerReceived(socket).empty());
+
+    client.stop();
+}
+
+enum WindowMode {
+    NO_WINDOW,
+    SYNC_WINDOW,
+    AVAILABLE_FOR_WRITE,
+    ASYNC_CLIENT
+};
+
+static void uplink(Modem &modem, FakeSaraR4 &sara, WindowMode mode, const char *name) {
+    NBClient client(modem, mode != ASYNC_CLIENT);
+    std::string body = benchPattern(16384);
+    size_t sent = 0;
+    double maxBlockedMs = 0;
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    while (mode == ASYNC_CLIENT && client.ready() == 0) {
+        modem.waitForData(10);
+    }
+    int socket = sara.lastCreatedSocket();
+
+    // 4 KB send buffer in the modem, acknowledged at 1 KB/s
+    sara.setUplink(4096, 1024);
+    client.setSendWindow(mode == NO_WINDOW ? (size_t) -1 : 3072);
+
+    sara.clearLog();
+    BenchTimer timer;
+    if (mode == AVAILABLE_FOR_WRITE || mode == ASYNC_CLIENT) {
+        client.beginWrite(false);
+
+        unsigned long start = millis();
+        while (sent < body.size() && millis() - start < 60000) {
+            BenchTimer blocked;
+            size_t room = (size_t) client.availableForWrite();
+
+            if (room >= 512 || room >= body.size() - sent) {
+                size_t length = std::min(room, body.size() - sent);
+
+                sent += client.write((const uint8_t *) body.data() + sent, length);
+            }
+            maxBlockedMs = std::max(maxBlockedMs, blocked.virtualMillis());
+
+            // the sketch's own work
+            modem.poll();
+            delay(20);
+        }
+        while (client.ready() == 0) {
+            modem.waitForData(100);
+        }
+        client.endWrite();
+    } else {
+        sent = client.write((const uint8_t *) body.data(), body.size());
+        maxBlockedMs = timer.virtualMillis();
+    }
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(sara.peerReceived(socket) == body.substr(0, sent));
+    BENCH_CHECK(mode == NO_WINDOW ? sent < body.size() : sent == body.size());
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14zu\n", "  bytes sent", sent);
+    printf("%-34s %14lu\n", "  AT+USOCTL", sara.commandCount("AT+USOCTL"));
+    printf("%-34s %14.1f\n", "  longest write() ms", maxBlockedMs);
+
+    sara.setUplink(0, 0);
+    client.stop();
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+    const size_t sizes[] = {1024, 4096, 16384};
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    benchHeader("TCP send");
+    for (size_t size : sizes) {
+        upload(modem, sara, size, false);
+        upload(modem, sara, size, true);
+    }
+
+    shortWrites(modem, sara);
+
+    benchHeader("TCP send window, 1 KB/s uplink");
+    uplink(modem, sara, NO_WINDOW, "no send window");
+    uplink(modem, sara, SYNC_WINDOW, "3 KB window, sync write");
+    uplink(modem, sara, AVAILABLE_FOR_WRITE, "3 KB window, availableForWrite");
+    uplink(modem, sara, ASYNC_CLIENT, "3 KB window, async client");
+
+    return 0;
+}
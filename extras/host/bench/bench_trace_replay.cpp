@@ -0,0 +1,174 @@
+/*
+  UART trace capture and replay.
+
+  Records a session against the simulated SARA-R4 (registration, attach, TCP
+  download, UDP exchange) with a ModemPrintTrace and a ModemRingTrace, then
+  replays the trace through the library with TraceReplay. Checks that the
+  replay reproduces every command and URC of the recording, and reports the
+  trace size and how much faster than real time the replay runs.
+
+  usage: bench_trace_replay [trace-file]
+  writes the recorded trace to trace-file, for trying out sara_r4_replay.
+*/
+
+#include <fstream>
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "TraceReplay.h"
+#include "BenchUtil.h"
+
+// Print collecting everything written to it
+class StringPrint : public Print {
+public:
+    std::string data;
+
+    size_t write(uint8_t c) override {
+        data += (char) c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t size) override {
+        data.append((const char *) buf, size);
+        return size;
+    }
+};
+
+static std::string receivedBytes(const TraceReplay &trace) {
+    std::string bytes;
+
+    for (auto const &record : trace.records()) {
+        if (record.rx) {
+            bytes += record.data;
+        }
+    }
+
+    return bytes;
+}
+
+static void runSession(Modem &modem, FakeSaraR4 &sara) {
+    NB nb(modem);
+    GPRS gprs(modem);
+    NBClient client(modem);
+    NBUDP udp(modem);
+    std::string body(2048, 'r');
+    std::string received;
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    client.print("GET / HTTP/1.1\r\n\r\n");
+    sara.peerSend(sara.lastCreatedSocket(), body, 100);
+
+    uint8_t buf[256];
+    unsigned long start = millis();
+    while (received.size() < body.size() && millis() - start < 10000) {
+        int n = client.read(buf, sizeof(buf));
+        if (n > 0) {
+            received.append((const char *) buf, n);
+        }
+    }
+    BENCH_CHECK(received == body);
+    client.stop();
+
+    BENCH_CHECK(udp.begin(5000));
+    BENCH_CHECK(udp.beginPacket("192.0.2.1", 7));
+    udp.write((const uint8_t *) "ping", 4);
+    BENCH_CHECK(udp.endPacket());
+    sara.peerSendFrom(sara.lastCreatedSocket(), "192.0.2.1", 7, "pong", 50);
+
+    int size = 0;
+    start = millis();
+    while ((size = udp.parsePacket()) == 0 && millis() - start < 5000) {
+        modem.waitForData(100);
+    }
+    BENCH_CHECK(size == 4);
+    udp.stop();
+}
+
+int main(int argc, char **argv) {
+    static uint8_t ringBuffer[4096];
+
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    ModemStats recordedStats;
+    StringPrint trace;
+    ModemPrintTrace printTrace(trace);
+
+    modem.setStats(&recordedStats);
+    modem.setTrace(&printTrace);
+    runSession(modem, sara);
+    modem.poll();
+    printTrace.flush();
+
+    printf("\n== Trace capture ==\n");
+    printf("%-34s %14lu\n", "UART bytes", (unsigned long) (sara.bytesFromHost() + sara.bytesToHost()));
+    printf("%-34s %14zu\n", "trace bytes", trace.data.size());
+
+    if (argc > 1) {
+        std::ofstream(argv[1], std::ios::binary) << trace.data;
+    }
+
+    // a ring keeps the end of the same session
+    {
+        FakeSaraR4 ringSara;
+        Modem ringModem(ringSara, 115200, 255, 5);
+        ModemRingTrace ring(ringBuffer, sizeof(ringBuffer));
+        StringPrint dump;
+        TraceReplay full;
+        TraceReplay tail;
+        std::string error;
+
+        ringModem.setTrace(&ring);
+        runSession(ringModem, ringSara);
+        ringModem.poll();
+        ring.dump(dump);
+
+        BENCH_CHECK(full.load(trace.data, error));
+        BENCH_CHECK(tail.load(dump.data, error));
+        BENCH_CHECK(dump.data.size() <= sizeof(ringBuffer) + 8);
+
+        // the ring holds the end of what the modem sent
+        std::string fullRx = receivedBytes(full);
+        std::string tailRx = receivedBytes(tail);
+        BENCH_CHECK(!tailRx.empty() && tailRx.size() < fullRx.size());
+        BENCH_CHECK(fullRx.compare(fullRx.size() - tailRx.size(), tailRx.size(), tailRx) == 0);
+
+        printf("%-34s %14zu\n", "ring dump bytes (4 KB ring)", dump.data.size());
+    }
+
+    TraceReplay replay;
+    std::string error;
+    BENCH_CHECK(replay.load(trace.data, error));
+
+    Modem replayModem(replay, 115200, 255, 5);
+    ModemStats replayedStats;
+    ReplayReport report;
+
+    replayModem.setStats(&replayedStats);
+    replayTrace(replay, replayModem, report);
+
+    unsigned long recordedCommands = 0;
+    for (int i = 0; i < recordedStats.verbs(); i++) {
+        recordedCommands += recordedStats.verb(i).count;
+    }
+
+    BENCH_CHECK(report.commands == recordedCommands);
+    BENCH_CHECK(report.timeouts == 0);
+    BENCH_CHECK(report.mismatches == 0);
+    BENCH_CHECK(report.urcs == recordedStats.urcs());
+    BENCH_CHECK(replayedStats.bytesReceived() == recordedStats.bytesReceived());
+
+    printf("\n== Trace replay ==\n");
+    printf("%-34s %14lu\n", "commands", report.commands);
+    printf("%-34s %14lu\n", "URCs", report.urcs);
+    printf("%-34s %14lu\n", "recorded ms", report.recordedMillis);
+    printf("%-34s %14.1f\n", "replayed ms (virtual)", report.replayedMillis);
+    printf("%-34s %14.1f\n", "host ms", report.wallMicros / 1000.0);
+    printf("%-34s %13.0fx\n", "faster than real time", report.recordedMillis / (report.wallMicros / 1000.0));
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+  URC dispatch cost versus the number of registered handlers.
+
+  Streams socket URCs (+UUSORD for every open socket) and a registration URC
+  through Modem::poll with 1 to 8 handlers attached, once with every handler
+  receiving every URC and filtering it itself, the way NBClient and NBUDP
+  used to, and once with handlers registered for their URC prefix and socket.
+  Checks that handlers overriding the deprecated String signature still
+  receive URCs.
+*/
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <Modem.h>
+
+#include "BenchUtil.h"
+#include "MemorySerial.h"
+
+// Handler that filters +UUSORD URCs of its own socket
+class SocketUrcHandler : public ModemUrcHandler {
+public:
+    explicit SocketUrcHandler(int socket) : socket(socket), count(0) {}
+
+    void handleUrc(const char *urc) override {
+        if (strncmp(urc, "+UUSORD: ", 9) == 0 && urc[9] - '0' == socket) {
+            count++;
+        }
+    }
+
+    int socket;
+    unsigned long count;
+};
+
+// Handler interested in network registration URCs only
+class RegistrationUrcHandler : public ModemUrcHandler {
+public:
+    RegistrationUrcHandler() : count(0) {}
+
+    void handleUrc(const char *urc) override {
+        if (strncmp(urc, "+CEREG: ", 8) == 0) {
+            count++;
+        }
+    }
+
+    unsigned long count;
+};
+
+// Handler written for the deprecated String signature
+class LegacyUrcHandler : public ModemUrcHandler {
+public:
+    LegacyUrcHandler() : count(0) {}
+
+    void handleUrc(const String &urc) override {
+        if (urc.startsWith("+CEREG: ")) {
+            count++;
+        }
+    }
+
+    unsigned long count;
+};
+
+static std::string buildStream(int sockets, int repeat) {
+    std::string stream;
+
+    for (int r = 0; r < repeat; r++) {
+        for (int s = 0; s < sockets; s++) {
+            stream += "\r\n+UUSORD: " + std::to_string(s) + ",64\r\n";
+        }
+        stream += "\r\n+CEREG: 1\r\n";
+    }
+
+    return stream;
+}
+
+static double runNsPerUrc(int handlers, bool routed, int repeat) {
+    int sockets = handlers < MODEM_NUM_SOCKETS ? handlers : MODEM_NUM_SOCKETS;
+    bool registration = handlers > MODEM_NUM_SOCKETS;
+    std::string stream = buildStream(sockets, repeat);
+    MemorySerial serial;
+    Modem modem(serial, 115200, 255, 5);
+    std::vector<SocketUrcHandler> socketHandlers;
+    RegistrationUrcHandler registrationHandler;
+
+    for (int s = 0; s < sockets; s++) {
+        socketHandlers.emplace_back(s);
+    }
+
+    for (auto &handler : socketHandlers) {
+        if (routed) {
+            BENCH_CHECK(modem.addUrcHandler(&handler, "+UUSORD", handler.socket));
+        } else {
+            modem.addUrcHandler(&handler);
+        }
+    }
+
+    if (registration) {
+        if (routed) {
+            BENCH_CHECK(modem.addUrcHandler(&registrationHandler, "+CEREG"));
+        } else {
+            modem.addUrcHandler(&registrationHandler);
+        }
+    }
+
+    serial.load(stream);
+    BenchTimer timer;
+    while (serial.available()) {
+        modem.poll();
+    }
+    double us = timer.wallMicros();
+
+    for (auto const &handler : socketHandlers) {
+        BENCH_CHECK(handler.count == (unsigned long) repeat);
+    }
+    BENCH_CHECK(registrationHandler.count == (registration ? (unsigned long) repeat : 0UL));
+
+    return us * 1000.0 / ((double) (sockets + 1) * repeat);
+}
+
+int main() {
+    const int repeat = 20000;
+    const int handlerCounts[] = {0, 1, 2, 4, 8};
+
+    printf("\n== URC dispatch ==\n");
+    printf("%-10s %18s %18s\n", "handlers", "broadcast ns/URC", "routed ns/URC");
+
+    for (int handlers : handlerCounts) {
+        double broadcast = runNsPerUrc(handlers, false, repeat);
+        double routed = runNsPerUrc(handlers, true, repeat);
+
+        printf("%-10d %18.1f %18.1f\n", handlers, broadcast, routed);
+    }
+
+    // handlers of the String signature still receive URCs, routed or not
+    MemorySerial serial;
+    Modem modem(serial, 115200, 255, 5);
+    LegacyUrcHandler broadcast;
+    LegacyUrcHandler routed;
+
+    modem.addUrcHandler(&broadcast);
+    BENCH_CHECK(modem.addUrcHandler(&routed, "+CEREG"));
+    serial.load(buildStream(2, 3));
+    while (serial.available()) {
+        modem.poll();
+    }
+    BENCH_CHECK(broadcast.count == 3 && routed.count == 3);
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+  Write coalescing in NBClient against the simulated SARA-R4.
+
+  Sends an HTTP request the way sketches usually do, one print() per header
+  field, once flushing after every print() (one AT+USOWR per write, as
+  before writes were collected) and once letting the client collect the
+  writes. A third case leaves the last bytes to the idle flush timeout, a
+  fourth has an async client poll available() for the response right after
+  its prints. Reports the AT+USOWR commands and the virtual time to send the
+  request.
+*/
+
+#include <string>
+
+#include <SARAClient.h>
+
+#include "FakeSaraR4.h"
+#include "BenchUtil.h"
+
+static const char *const FIELDS[] = {
+        "POST /api/v1/telemetry HTTP/1.1\r\n",
+        "Host: ", "example.org", "\r\n",
+        "User-Agent: ", "MKRNB/1.0", "\r\n",
+        "Content-Type: ", "application/json", "\r\n",
+        "Content-Length: ", "42", "\r\n",
+        "Connection: ", "close", "\r\n",
+        "\r\n",
+        "{\"temperature\":", "21.5", ",\"humidity\":", "48", ",\"battery\":", "97", "}",
+};
+
+static const int NUM_FIELDS = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+enum Mode {
+    FLUSH_EACH,
+    COLLECT,
+    IDLE_TIMEOUT,
+    ASYNC_AVAILABLE
+};
+
+static void sendRequest(Modem &modem, FakeSaraR4 &sara, Mode mode, const char *name) {
+    NBClient client(modem, mode != ASYNC_AVAILABLE);
+    std::string request;
+
+    BENCH_CHECK(client.connect("example.org", 80));
+    while (mode == ASYNC_AVAILABLE && client.ready() == 0) {
+        modem.waitForData(10);
+    }
+    int socket = sara.lastCreatedSocket();
+
+    sara.clearLog();
+    BenchTimer timer;
+    for (int i = 0; i < NUM_FIELDS; i++) {
+        client.print(FIELDS[i]);
+        request += FIELDS[i];
+
+        if (mode == FLUSH_EACH) {
+            client.flush();
+        }
+    }
+
+    if (mode == IDLE_TIMEOUT) {
+        // the sketch goes on with other work, connected() sends what is left
+        unsigned long start = millis();
+        while (sara.peerReceived(socket).size() < request.size() && millis() - start < 1000) {
+            delay(10);
+            client.connected();
+        }
+    } else if (mode == ASYNC_AVAILABLE) {
+        // an async client polling for the response sends what it collected
+        unsigned long start = millis();
+        bool answered = false;
+        while (client.available() == 0 && millis() - start < 1000) {
+            if (!answered && sara.peerReceived(socket) == request) {
+                sara.peerSend(socket, "HTTP/1.1 204 No Content\r\n\r\n", 20);
+                answered = true;
+            }
+            modem.waitForData(10);
+        }
+        BENCH_CHECK(client.available() > 0);
+    } else {
+        client.flush();
+    }
+    double ms = timer.virtualMillis();
+
+    BENCH_CHECK(sara.peerReceived(socket) == request);
+    BENCH_CHECK(client.writeCalls() == (unsigned long) NUM_FIELDS);
+    BENCH_CHECK(client.writeCommands() == sara.commandCount("AT+USOWR"));
+
+    benchRow(name, ms, timer.wallMicros(), sara.commandCount());
+    printf("%-34s %14lu\n", "  write() calls", client.writeCalls());
+    printf("%-34s %14lu\n", "  AT+USOWR", client.writeCommands());
+
+    client.stop();
+}
+
+int main() {
+    FakeSaraR4 sara;
+    Modem modem(sara, 115200, 255, 5);
+    NB nb(modem);
+    GPRS gprs(modem);
+
+    BENCH_CHECK(nb.begin(nullptr, "bench.apn") == NB_READY);
+    BENCH_CHECK(gprs.attachGPRS() == GPRS_READY);
+
+    benchHeader("Write coalescing");
+    sendRequest(modem, sara, FLUSH_EACH, "flush() after every print()");
+    sendRequest(modem, sara, COLLECT, "collected, one flush()");
+    sendRequest(modem, sara, IDLE_TIMEOUT, "collected, idle flush timeout");
+    sendRequest(modem, sara, ASYNC_AVAILABLE, "async, sent by available()");
+
+    return 0;
+}
@@ -0,0 +1,1113 @@
+/*
+  Scriptable simulation of a u-blox SARA-R4 module for the host build.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "FakeSaraR4.h"
+
+static const char *CME_OPERATION_NOT_ALLOWED = "Operation not allowed";
+
+void FakeSaraR4::setUplink(size_t bufferBytes, unsigned long bytesPerSecond) {
+    _uplinkBuffer = bufferBytes;
+    _uplinkRate = bytesPerSecond;
+}
+
+size_t FakeSaraR4::unacked(int socket) {
+    Socket &s = _sockets[socket];
+    uint64_t acked = (_eventTime - s.unackedAt) * _uplinkRate / 1000000ULL;
+
+    if (acked) {
+        s.unacked -= std::min((uint64_t) s.unacked, acked);
+        s.unackedAt = _eventTime;
+    }
+
+    if (s.unacked == 0) {
+        s.unackedAt = _eventTime;
+    }
+
+    return s.unacked;
+}
+
+void FakeSaraR4::Socket::reset() {
+    used = false;
+    protocol = 0;
+    connected = false;
+    peerClosed = false;
+    listening = false;
+    localPort = 0;
+    unacked = 0;
+    unackedAt = 0;
+    rx.clear();
+    rxDatagrams.clear();
+    options.clear();
+}
+
+FakeSaraR4::FakeSaraR4(unsigned long baud) :
+        _inputMode(INPUT_COMMAND),
+        _baud(baud),
+        _defaultLatencyMs(10),
+        _registrationDelayMs(0),
+        _writeLimit(0),
+        _uplinkBuffer(0),
+        _uplinkRate(0),
+        _txFreeAt(0),
+        _rxFreeAt(0),
+        _eventTime(0),
+        _dataRemaining(0),
+        _cmee(2),
+        _cfun(1),
+        _cfunOnAt(0),
+        _attached(false),
+        _pinLocked(false),
+        _nextSmsIndex(1),
+        _nextSmsReference(1),
+        _lastCreatedSocket(-1),
+        _commandCount(0),
+        _bytesFromHost(0),
+        _bytesToHost(0),
+        _emptyPolls(0),
+        _sleptMicros(0) {
+    _latencyMs["AT+CFUN"] = 300;
+    _latencyMs["AT+CGATT"] = 500;
+    _latencyMs["AT+COPS"] = 50;
+    _latencyMs["AT+USOCR"] = 20;
+    _latencyMs["AT+USOCO"] = 400;
+    _latencyMs["AT+USOCL"] = 60;
+    _latencyMs["AT+USOWR"] = 25;
+    _latencyMs["AT+USOST"] = 25;
+    _latencyMs["AT+USORD"] = 15;
+    _latencyMs["AT+USORF"] = 15;
+    _latencyMs["AT+USECMNG"] = 80;
+    _latencyMs["AT+CMGS"] = 1500;
+    _latencyMs["AT+CMGL"] = 40;
+}
+
+void FakeSaraR4::begin(unsigned long baud) {
+    _baud = baud;
+}
+
+void FakeSaraR4::end() {
+}
+
+uint64_t FakeSaraR4::byteTimeMicros(size_t count) const {
+    // 8N1 framing: 10 bits per byte
+    return ((uint64_t) count * 10000000ULL + _baud - 1) / _baud;
+}
+
+void FakeSaraR4::schedule(uint64_t at, std::function<void()> action) {
+    _events.insert(std::make_pair(at, action));
+}
+
+void FakeSaraR4::process() {
+    uint64_t now = hostMicros();
+
+    while (!_events.empty() && _events.begin()->first <= now) {
+        auto event = _events.begin();
+        std::function<void()> action = event->second;
+
+        _eventTime = event->first;
+        _events.erase(event);
+        action();
+    }
+}
+
+int FakeSaraR4::available() {
+    process();
+
+    uint64_t now = hostMicros();
+    size_t count = 0;
+
+    for (auto const &chunk : _rxChunks) {
+        if (chunk.start >= now) {
+            break;
+        }
+
+        uint64_t delivered = (now - chunk.start) * _baud / 10000000ULL;
+        if (delivered > chunk.data.size()) {
+            delivered = chunk.data.size();
+        }
+
+        count += delivered - chunk.pos;
+        if (delivered < chunk.data.size()) {
+            break;
+        }
+    }
+
+    if (count == 0) {
+        _emptyPolls++;
+        hostSpin();
+    }
+
+    return (int) count;
+}
+
+void FakeSaraR4::sleep(unsigned long maxMs) {
+    uint64_t wake = hostMicros() + (uint64_t) maxMs * 1000;
+
+    for (;;) {
+        process();
+
+        uint64_t now = hostMicros();
+        uint64_t next = wake;
+        bool event = false;
+
+        if (!_rxChunks.empty()) {
+            const Chunk &chunk = _rxChunks.front();
+            uint64_t arrival = chunk.start + byteTimeMicros(chunk.pos + 1) + 1;
+
+            if (arrival < next) {
+                next = arrival;
+            }
+        }
+
+        if (!_events.empty() && _events.begin()->first < next) {
+            next = _events.begin()->first;
+            event = true;
+        }
+
+        if (next > now) {
+            _sleptMicros += next - now;
+            hostAdvanceMicros(next - now);
+        }
+
+        // events only wake the host once they put data on the line
+        if (!event) {
+            return;
+        }
+    }
+}
+
+int FakeSaraR4::peek() {
+    if (!available()) {
+        return -1;
+    }
+
+    Chunk &chunk = _rxChunks.front();
+
+    return (uint8_t) chunk.data[chunk.pos];
+}
+
+int FakeSaraR4::read() {
+    if (!available()) {
+        return -1;
+    }
+
+    Chunk &chunk = _rxChunks.front();
+    uint8_t c = chunk.data[chunk.pos++];
+
+    if (chunk.pos == chunk.data.size()) {
+        _rxChunks.pop_front();
+    }
+
+    _bytesToHost++;
+
+    return c;
+}
+
+size_t FakeSaraR4::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t FakeSaraR4::write(const uint8_t *buf, size_t size) {
+    uint64_t now = hostMicros();
+
+    if (_txFreeAt < now) {
+        _txFreeAt = now;
+    }
+    _txFreeAt += byteTimeMicros(size);
+    _bytesFromHost += size;
+
+    std::string bytes((const char *) buf, size);
+    schedule(_txFreeAt, [this, bytes]() { receive(bytes); });
+
+    return size;
+}
+
+void FakeSaraR4::flush() {
+    // wait for the transmit shift register to drain
+    uint64_t now = hostMicros();
+
+    if (_txFreeAt > now) {
+        hostAdvanceMicros(_txFreeAt - now);
+    }
+}
+
+void FakeSaraR4::emit(const std::string &bytes) {
+    Chunk chunk;
+
+    if (bytes.empty()) {
+        return;
+    }
+
+    chunk.start = std::max(_eventTime, _rxFreeAt);
+    chunk.data = bytes;
+    chunk.pos = 0;
+
+    _rxFreeAt = chunk.start + byteTimeMicros(bytes.size());
+    _rxChunks.push_back(chunk);
+}
+
+void FakeSaraR4::emitUrc(const std::string &line) {
+    emit("\r\n" + line + "\r\n");
+}
+
+void FakeSaraR4::emitReply(const Reply &reply) {
+    std::string out;
+
+    // information text lines are separated by a single <CR><LF>
+    if (!reply.info.empty()) {
+        out += "\r\n";
+    }
+
+    for (auto const &line : reply.info) {
+        out += line + "\r\n";
+    }
+
+    if (!reply.result.empty()) {
+        out += "\r\n" + reply.result + "\r\n";
+    }
+
+    emit(out);
+}
+
+void FakeSaraR4::sendUrc(const std::string &line, unsigned long delayMs) {
+    schedule(hostMicros() + delayMs * 1000ULL, [this, line]() { emitUrc(line); });
+}
+
+void FakeSaraR4::deliverSms(const char *from, const char *text) {
+    Sms sms;
+
+    sms.index = _nextSmsIndex++;
+    sms.from = from;
+    sms.text = text;
+    sms.read = false;
+    _sms.push_back(sms);
+
+    char urc[32];
+    snprintf(urc, sizeof(urc), "+CMTI: \"ME\",%d", sms.index);
+    sendUrc(urc);
+}
+
+void FakeSaraR4::peerSend(int socket, const std::string &data, unsigned long delayMs) {
+    schedule(hostMicros() + delayMs * 1000ULL, [this, socket, data]() {
+        Socket &s = _sockets[socket];
+
+        if (!s.used || !s.connected || s.protocol != 6) {
+            return;
+        }
+
+        s.rx += data;
+
+        char urc[32];
+        snprintf(urc, sizeof(urc), "+UUSORD: %d,%u", socket, (unsigned) s.rx.size());
+        emitUrc(urc);
+    });
+}
+
+void FakeSaraR4::peerSendFrom(int socket, const char *ip, uint16_t port, const std::string &data,
+                              unsigned long delayMs) {
+    Datagram datagram;
+
+    datagram.ip = ip;
+    datagram.port = port;
+    datagram.data = data;
+
+    schedule(hostMicros() + delayMs * 1000ULL, [this, socket, datagram]() {
+        Socket &s = _sockets[socket];
+
+        if (!s.used || s.protocol != 17 || !s.listening) {
+            return;
+        }
+
+        s.rxDatagrams.push_back(datagram);
+
+        char urc[32];
+        snprintf(urc, sizeof(urc), "+UUSORF: %d,%u", socket, (unsigned) datagram.data.size());
+        emitUrc(urc);
+    });
+}
+
+void FakeSaraR4::peerClose(int socket, unsigned long delayMs) {
+    schedule(hostMicros() + delayMs * 1000ULL, [this, socket]() {
+        Socket &s = _sockets[socket];
+
+        if (!s.used || !s.connected) {
+            return;
+        }
+
+        s.peerClosed = true;
+
+        // the module reports the closure once all received data was read
+        if (s.rx.empty()) {
+            closeSocket(socket);
+        }
+    });
+}
+
+void FakeSaraR4::peerCloseUnread(int socket, unsigned long delayMs) {
+    schedule(hostMicros() + delayMs * 1000ULL, [this, socket]() {
+        Socket &s = _sockets[socket];
+
+        if (!s.used || !s.connected) {
+            return;
+        }
+
+        if (s.rx.empty()) {
+            closeSocket(socket);
+            return;
+        }
+
+        // the socket is released once the last byte was read
+        s.connected = false;
+
+        char urc[32];
+        snprintf(urc, sizeof(urc), "+UUSOCL: %d", socket);
+        emitUrc(urc);
+    });
+}
+
+void FakeSaraR4::peerConnect(int listeningSocket, const char *ip, uint16_t port, unsigned long delayMs) {
+    std::string address = ip;
+
+    schedule(hostMicros() + delayMs * 1000ULL, [this, listeningSocket, address, port]() {
+        Socket &listener = _sockets[listeningSocket];
+
+        if (!listener.used || listener.protocol != 6 || !listener.listening) {
+            return;
+        }
+
+        for (int i = 0; i < NUM_SOCKETS; i++) {
+            Socket &s = _sockets[i];
+
+            if (!s.used) {
+                s.reset();
+                s.used = true;
+                s.protocol = 6;
+                s.connected = true;
+                s.localPort = listener.localPort;
+
+                char urc[96];
+                snprintf(urc, sizeof(urc), "+UUSOLI: %d,\"%s\",%u,%d,\"10.170.3.27\",%u", i, address.c_str(),
+                         (unsigned) port, listeningSocket, (unsigned) listener.localPort);
+                emitUrc(urc);
+                return;
+            }
+        }
+    });
+}
+
+void FakeSaraR4::closeSocket(int socket) {
+    char urc[32];
+
+    snprintf(urc, sizeof(urc), "+UUSOCL: %d", socket);
+    _sockets[socket].reset();
+    emitUrc(urc);
+}
+
+unsigned long FakeSaraR4::commandCount(const char *verb) const {
+    auto it = _verbCounts.find(verb);
+
+    return it == _verbCounts.end() ? 0 : it->second;
+}
+
+void FakeSaraR4::clearLog() {
+    _commandCount = 0;
+    _verbCounts.clear();
+    _commandLog.clear();
+    _bytesFromHost = 0;
+    _bytesToHost = 0;
+    _emptyPolls = 0;
+    _sleptMicros = 0;
+}
+
+void FakeSaraR4::receive(const std::string &bytes) {
+    std::string echo;
+
+    for (char c : bytes) {
+        switch (_inputMode) {
+            case INPUT_CERT_DATA: {
+                echo += c;
+                _data += c;
+
+                if (--_dataRemaining == 0) {
+                    _inputMode = INPUT_COMMAND;
+                    _certs[_certName] = _data.size();
+
+                    Reply reply;
+                    reply.info.push_back("+USECMNG: 0,0,\"" + _certName + "\",\"5d41402abc4b2a76b9719d911017c592\"");
+                    emit(echo);
+                    echo.clear();
+
+                    uint64_t at = _eventTime + latencyFor("AT+USECMNG") * 1000ULL;
+                    schedule(at, [this, reply]() { emitReply(reply); });
+                }
+                break;
+            }
+
+            case INPUT_SMS_TEXT: {
+                if (c == 0x1a) {
+                    _inputMode = INPUT_COMMAND;
+
+                    char info[32];
+                    snprintf(info, sizeof(info), "+CMGS: %d", _nextSmsReference++);
+
+                    Reply reply;
+                    reply.info.push_back(info);
+                    emit(echo);
+                    echo.clear();
+
+                    uint64_t at = _eventTime + latencyFor("AT+CMGS") * 1000ULL;
+                    schedule(at, [this, reply]() { emitReply(reply); });
+                } else if (c == 0x1b) {
+                    _inputMode = INPUT_COMMAND;
+                    emit(echo);
+                    echo.clear();
+                    emitReply(Reply());
+                } else {
+                    echo += c;
+                    _data += c;
+                }
+                break;
+            }
+
+            case INPUT_COMMAND:
+            default: {
+                echo += c;
+
+                if (c == '\r') {
+                    std::string text = _line;
+
+                    _line.clear();
+                    emit(echo);
+                    echo.clear();
+
+                    if (!text.empty()) {
+                        execute(text);
+                    }
+                } else if (c != '\n') {
+                    _line += c;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!echo.empty()) {
+        emit(echo);
+    }
+}
+
+bool FakeSaraR4::parse(const std::string &text, Command &command) {
+    if (text.size() < 2 || toupper(text[0]) != 'A' || toupper(text[1]) != 'T') {
+        return false;
+    }
+
+    size_t end = text.find_first_of("=?");
+
+    command.text = text;
+    command.verb = text.substr(0, end);
+    command.args.clear();
+    command.type = 0;
+
+    std::transform(command.verb.begin(), command.verb.end(), command.verb.begin(), ::toupper);
+
+    if (end == std::string::npos) {
+        return true;
+    }
+
+    if (text[end] == '?') {
+        command.type = '?';
+        return true;
+    }
+
+    if (text.compare(end, 2, "=?") == 0) {
+        command.type = 't';
+        return true;
+    }
+
+    command.type = '=';
+
+    std::string arg;
+    bool quoted = false;
+
+    for (size_t i = end + 1; i < text.size(); i++) {
+        char c = text[i];
+
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            command.args.push_back(arg);
+            arg.clear();
+        } else {
+            arg += c;
+        }
+    }
+    command.args.push_back(arg);
+
+    return true;
+}
+
+unsigned long FakeSaraR4::latencyFor(const std::string &verb) const {
+    auto it = _latencyMs.find(verb);
+
+    return it == _latencyMs.end() ? _defaultLatencyMs : it->second;
+}
+
+void FakeSaraR4::execute(const std::string &text) {
+    Command command;
+
+    _commandCount++;
+    _commandLog.push_back(text);
+
+    if (!parse(text, command)) {
+        schedule(_eventTime + _defaultLatencyMs * 1000ULL, [this]() { emitReply(error(100, "unknown")); });
+        return;
+    }
+
+    _verbCounts[command.verb]++;
+
+    uint64_t start = _eventTime;
+    // prompting commands answer with the prompt right away, their latency applies to the data phase
+    bool prompts = command.verb == "AT+CMGS" || (command.verb == "AT+USECMNG" && !command.args.empty() &&
+                                                 command.args[0] == "0");
+    // so does the asynchronous close, the closure itself is reported with +UUSOCL
+    bool asyncClose = command.verb == "AT+USOCL" && command.args.size() > 1 && command.args[1] == "1";
+    unsigned long latency = prompts || asyncClose ? _defaultLatencyMs : latencyFor(command.verb);
+    auto failure = _failures.find(command.verb);
+
+    if (failure != _failures.end() && !failure->second.empty()) {
+        Reply reply;
+
+        reply.result = failure->second.front();
+        failure->second.pop_front();
+
+        schedule(start + latency * 1000ULL, [this, reply]() { emitReply(reply); });
+        return;
+    }
+
+    // state changes take effect once the module has processed the command
+    schedule(start + latency * 1000ULL, [this, command]() {
+        Reply reply = dispatch(command);
+
+        if (reply.extraLatency) {
+            schedule(_eventTime + reply.extraLatency * 1000ULL, [this, reply]() { emitReply(reply); });
+        } else if (!reply.info.empty() || !reply.result.empty()) {
+            emitReply(reply);
+        }
+    });
+}
+
+FakeSaraR4::Reply FakeSaraR4::error(int code, const char *text) const {
+    Reply reply;
+    char buf[64];
+
+    if (_cmee == 0) {
+        reply.result = "ERROR";
+    } else if (_cmee == 1) {
+        snprintf(buf, sizeof(buf), "+CME ERROR: %d", code);
+        reply.result = buf;
+    } else {
+        snprintf(buf, sizeof(buf), "+CME ERROR: %s", text);
+        reply.result = buf;
+    }
+
+    return reply;
+}
+
+int FakeSaraR4::registrationStatus() const {
+    if (_cfun != 1) {
+        return 0;
+    }
+
+    if (_eventTime < _cfunOnAt + _registrationDelayMs * 1000ULL) {
+        return 2;
+    }
+
+    return 1;
+}
+
+FakeSaraR4::Reply FakeSaraR4::dispatch(const Command &command) {
+    const std::string &verb = command.verb;
+    const std::vector<std::string> &args = command.args;
+    Reply reply;
+    char buf[64];
+
+    auto custom = _handlers.find(verb);
+    if (custom != _handlers.end()) {
+        return custom->second(command);
+    }
+
+    auto arg = [&args](size_t i) -> int {
+        return i < args.size() ? atoi(args[i].c_str()) : -1;
+    };
+
+    auto socketArg = [this, &arg]() -> int {
+        int socket = arg(0);
+
+        if (socket < 0 || socket >= NUM_SOCKETS || !_sockets[socket].used) {
+            return -1;
+        }
+
+        return socket;
+    };
+
+    if (verb == "AT" || verb == "AT+CPWROFF" || verb == "AT+CMGF" || verb == "AT+UDCONF" ||
+        verb == "AT+CTZU" || verb == "AT+CGDCONT" || verb == "AT+UAUTHREQ" || verb == "AT+CPWD" ||
+        verb == "AT+URAT" || verb == "AT+UMNOPROF" || verb == "AT+USECPRF") {
+        return reply;
+    }
+
+    if (verb == "AT+IPR") {
+        // the new rate applies once the host reopens the port
+        return reply;
+    }
+
+    if (verb == "AT+CMEE") {
+        _cmee = arg(0);
+        return reply;
+    }
+
+    if (verb == "AT+CFUN") {
+        if (command.type == '?') {
+            snprintf(buf, sizeof(buf), "+CFUN: %d", _cfun);
+            reply.info.push_back(buf);
+        } else if (arg(0) == 15 || arg(0) == 16) {
+            _cfun = 1;
+            _cfunOnAt = _eventTime;
+        } else {
+            if (arg(0) == 1 && _cfun != 1) {
+                _cfunOnAt = _eventTime;
+            }
+            _cfun = arg(0);
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CPIN") {
+        if (command.type == '?') {
+            reply.info.push_back(_pinLocked ? "+CPIN: SIM PIN" : "+CPIN: READY");
+        } else if (_pin.empty() || args[0] == _pin) {
+            _pinLocked = false;
+        } else {
+            return error(16, "incorrect password");
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CLCK") {
+        if (arg(2) == 2 || args.size() == 2) {
+            reply.info.push_back(_pin.empty() ? "+CLCK: 0" : "+CLCK: 1");
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CEREG") {
+        snprintf(buf, sizeof(buf), "+CEREG: 0,%d", registrationStatus());
+        reply.info.push_back(buf);
+        return reply;
+    }
+
+    if (verb == "AT+CGATT") {
+        if (command.type == '?') {
+            reply.info.push_back(_attached ? "+CGATT: 1" : "+CGATT: 0");
+        } else {
+            _attached = arg(0) == 1 && registrationStatus() == 1;
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CGACT") {
+        reply.info.push_back(_attached ? "+CGACT: 1,1" : "+CGACT: 1,0");
+        return reply;
+    }
+
+    if (verb == "AT+CGPADDR") {
+        reply.info.push_back("+CGPADDR: 1,10.170.3.27");
+        return reply;
+    }
+
+    if (verb == "AT+CCLK") {
+        reply.info.push_back("+CCLK: \"26/10/17,12:00:00+00\"");
+        return reply;
+    }
+
+    if (verb == "AT+CSQ") {
+        reply.info.push_back("+CSQ: 21,99");
+        return reply;
+    }
+
+    if (verb == "AT+COPS") {
+        if (command.type == 't') {
+            reply.info.push_back("+COPS: (2,\"Simulated NB\",\"SimNB\",\"00101\",9),(1,\"Other\",\"Oth\",\"00102\",8),,(0,1,2,3,4),(0,1,2)");
+            reply.extraLatency = 3000;
+        } else if (command.type == '?') {
+            reply.info.push_back("+COPS: 0,0,\"Simulated NB\",9");
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CGSN") {
+        reply.info.push_back("356726100000001");
+        return reply;
+    }
+
+    if (verb == "AT+CCID") {
+        reply.info.push_back("+CCID: 8901260000000000001");
+        return reply;
+    }
+
+    if (verb == "AT+CMGS") {
+        _inputMode = INPUT_SMS_TEXT;
+        _data.clear();
+        emit("\r\n> ");
+        reply.result.clear();
+        return reply;
+    }
+
+    if (verb == "AT+CMGL") {
+        bool all = !args.empty() && args[0] == "ALL";
+
+        for (auto &sms : _sms) {
+            if (!all && sms.read) {
+                continue;
+            }
+
+            snprintf(buf, sizeof(buf), "+CMGL: %d,\"%s\",\"", sms.index, sms.read ? "REC READ" : "REC UNREAD");
+            reply.info.push_back(buf + sms.from + "\",,\"26/10/17,12:00:00+00\"");
+            reply.info.push_back(sms.text);
+            sms.read = true;
+        }
+        return reply;
+    }
+
+    if (verb == "AT+CMGD") {
+        int index = arg(0);
+
+        _sms.erase(std::remove_if(_sms.begin(), _sms.end(), [index](const Sms &sms) { return sms.index == index; }),
+                   _sms.end());
+        return reply;
+    }
+
+    if (verb == "AT+USECMNG") {
+        int op = arg(0);
+
+        if (op == 0 && args.size() >= 4) {
+            _inputMode = INPUT_CERT_DATA;
+            _certName = args[2];
+            _dataRemaining = (size_t) arg(3);
+            _data.clear();
+            emit(">");
+            reply.result.clear();
+        } else if (op == 2 && args.size() >= 3) {
+            if (!_certs.erase(args[2])) {
+                return error(4, CME_OPERATION_NOT_ALLOWED);
+            }
+        }
+        return reply;
+    }
+
+    if (verb == "AT+USOCR") {
+        int protocol = arg(0);
+
+        if (protocol != 6 && protocol != 17) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        for (int i = 0; i < NUM_SOCKETS; i++) {
+            Socket &s = _sockets[i];
+
+            if (!s.used) {
+                s.reset();
+                s.used = true;
+                s.protocol = protocol;
+                s.localPort = args.size() > 1 ? (uint16_t) arg(1) : 0;
+                s.tx.clear();
+                _lastCreatedSocket = i;
+
+                snprintf(buf, sizeof(buf), "+USOCR: %d", i);
+                reply.info.push_back(buf);
+                return reply;
+            }
+        }
+
+        return error(4, CME_OPERATION_NOT_ALLOWED);
+    }
+
+    if (verb == "AT+USOSEC") {
+        if (socketArg() < 0) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+        return reply;
+    }
+
+    if (verb == "AT+USOCO") {
+        int socket = socketArg();
+
+        if (socket < 0 || _sockets[socket].protocol != 6 || _sockets[socket].connected || !_attached) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        _sockets[socket].connected = true;
+        return reply;
+    }
+
+    if (verb == "AT+USOLI") {
+        int socket = socketArg();
+
+        if (socket < 0) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        _sockets[socket].listening = true;
+        _sockets[socket].localPort = (uint16_t) arg(1);
+        return reply;
+    }
+
+    if (verb == "AT+USOWR") {
+        int socket = socketArg();
+        std::string data;
+
+        if (socket < 0 || !_sockets[socket].connected || args.size() < 3) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        if ((size_t) arg(1) > MAX_WRITE_LENGTH || !fromHex(args[2], data) || data.size() != (size_t) arg(1)) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        if (_writeLimit && data.size() > _writeLimit) {
+            data.resize(_writeLimit);
+        }
+
+        // a full send buffer takes what fits
+        if (_uplinkRate) {
+            size_t room = _uplinkBuffer - std::min(_uplinkBuffer, unacked(socket));
+
+            if (data.size() > room) {
+                data.resize(room);
+            }
+
+            _sockets[socket].unacked += data.size();
+        }
+
+        _sockets[socket].tx += data;
+
+        snprintf(buf, sizeof(buf), "+USOWR: %d,%u", socket, (unsigned) data.size());
+        reply.info.push_back(buf);
+        return reply;
+    }
+
+    if (verb == "AT+USORD") {
+        int socket = socketArg();
+
+        if (socket < 0 || (_sockets[socket].rx.empty() && !_sockets[socket].connected)) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        Socket &s = _sockets[socket];
+        size_t length = (size_t) arg(1);
+
+        if (length == 0) {
+            snprintf(buf, sizeof(buf), "+USORD: %d,%u", socket, (unsigned) s.rx.size());
+            reply.info.push_back(buf);
+            return reply;
+        }
+
+        length = std::min(std::min(length, MAX_READ_LENGTH), s.rx.size());
+
+        std::string data = s.rx.substr(0, length);
+        s.rx.erase(0, length);
+
+        snprintf(buf, sizeof(buf), "+USORD: %d,%u,\"", socket, (unsigned) length);
+        reply.info.push_back(buf + toHex(data) + "\"");
+
+        if (s.rx.empty() && !s.connected) {
+            s.reset();
+        } else if (s.rx.empty() && s.peerClosed) {
+            int closed = socket;
+            schedule(_eventTime + 20000ULL, [this, closed]() { closeSocket(closed); });
+        }
+
+        return reply;
+    }
+
+    if (verb == "AT+USOST") {
+        int socket = socketArg();
+        Datagram datagram;
+
+        if (socket < 0 || _sockets[socket].protocol != 17 || args.size() < 5) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        if ((size_t) arg(3) > MAX_WRITE_LENGTH || !fromHex(args[4], datagram.data) ||
+            datagram.data.size() != (size_t) arg(3)) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        datagram.ip = args[1];
+        datagram.port = (uint16_t) arg(2);
+        _datagramsSent.push_back(datagram);
+
+        snprintf(buf, sizeof(buf), "+USOST: %d,%u", socket, (unsigned) datagram.data.size());
+        reply.info.push_back(buf);
+        return reply;
+    }
+
+    if (verb == "AT+USORF") {
+        int socket = socketArg();
+
+        if (socket < 0 || _sockets[socket].protocol != 17) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        Socket &s = _sockets[socket];
+
+        if (arg(1) == 0) {
+            snprintf(buf, sizeof(buf), "+USORF: %d,%u", socket,
+                     (unsigned) (s.rxDatagrams.empty() ? 0 : s.rxDatagrams.front().data.size()));
+            reply.info.push_back(buf);
+            return reply;
+        }
+
+        if (s.rxDatagrams.empty()) {
+            snprintf(buf, sizeof(buf), "+USORF: %d,\"\",0,0,\"\"", socket);
+            reply.info.push_back(buf);
+            return reply;
+        }
+
+        Datagram datagram = s.rxDatagrams.front();
+        s.rxDatagrams.pop_front();
+
+        size_t length = std::min(datagram.data.size(), (size_t) arg(1));
+
+        snprintf(buf, sizeof(buf), "+USORF: %d,\"", socket);
+        std::string line = buf + datagram.ip;
+        snprintf(buf, sizeof(buf), "\",%u,%u,\"", datagram.port, (unsigned) length);
+        line += buf + toHex(datagram.data.substr(0, length)) + "\"";
+        reply.info.push_back(line);
+        return reply;
+    }
+
+    if (verb == "AT+USOCTL") {
+        int socket = socketArg();
+
+        if (socket < 0) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        int param = arg(1);
+        int value = 0;
+
+        switch (param) {
+            case 0:
+                value = _sockets[socket].protocol;
+                break;
+            case 10:
+                value = _sockets[socket].connected ? 4 : 0;
+                break;
+            case 11:
+                value = (int) unacked(socket);
+                break;
+            default:
+                break;
+        }
+
+        snprintf(buf, sizeof(buf), "+USOCTL: %d,%d,%d", socket, param, value);
+        reply.info.push_back(buf);
+        return reply;
+    }
+
+    if (verb == "AT+USOSO") {
+        int socket = socketArg();
+
+        if (socket < 0 || args.size() < 4) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        _sockets[socket].options[std::make_pair(arg(1), arg(2))] = std::make_pair(arg(3), arg(4));
+        return reply;
+    }
+
+    if (verb == "AT+USOGO") {
+        int socket = socketArg();
+
+        if (socket < 0 || args.size() < 3) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        auto option = _sockets[socket].options.find(std::make_pair(arg(1), arg(2)));
+        int value = option == _sockets[socket].options.end() ? 0 : option->second.first;
+        int value2 = option == _sockets[socket].options.end() ? -1 : option->second.second;
+
+        if (value2 >= 0) {
+            snprintf(buf, sizeof(buf), "+USOGO: %d,%d", value, value2);
+        } else {
+            snprintf(buf, sizeof(buf), "+USOGO: %d", value);
+        }
+        reply.info.push_back(buf);
+        return reply;
+    }
+
+    if (verb == "AT+USOCL") {
+        int socket = socketArg();
+
+        if (socket < 0) {
+            return error(4, CME_OPERATION_NOT_ALLOWED);
+        }
+
+        if (arg(1) == 1) {
+            // the asynchronous close is for TCP sockets only
+            if (_sockets[socket].protocol != 6) {
+                return error(4, CME_OPERATION_NOT_ALLOWED);
+            }
+
+            schedule(_eventTime + latencyFor("AT+USOCL") * 1000ULL, [this, socket]() { closeSocket(socket); });
+            return reply;
+        }
+
+        _sockets[socket].reset();
+        return reply;
+    }
+
+    return error(100, "unknown");
+}
+
+std::string FakeSaraR4::toHex(const std::string &data) {
+    static const char digits[] = "0123456789ABCDEF";
+    std::string hex;
+
+    hex.reserve(data.size() * 2);
+    for (unsigned char c : data) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0x0f];
+    }
+
+    return hex;
+}
+
+bool FakeSaraR4::fromHex(const std::string &hex, std::string &data) {
+    if (hex.size() % 2) {
+        return false;
+    }
+
+    data.clear();
+    data.reserve(hex.size() / 2);
+
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char pair[3] = {hex[i], hex[i + 1], 0};
+        char *end;
+        long value = strtol(pair, &end, 16);
+
+        if (*end != '\0') {
+            return false;
+        }
+
+        data += (char) value;
+    }
+
+    return true;
+}
@@ -0,0 +1,264 @@
+/*
+  Scriptable simulation of a u-blox SARA-R4 module for the host build.
+
+  FakeSaraR4 is a HardwareSerial that speaks the subset of the SARA-R4 AT
+  dialect used by the library (echo on, hex socket mode). Bytes travel over a
+  simulated UART at the configured baud rate on the virtual clock of the
+  Arduino shim, every command takes a configurable processing latency, and
+  the remote end of each socket can be driven from the benchmark (peerSend,
+  peerClose, ...), which produces the same URCs as the real module.
+*/
+
+#ifndef _FAKE_SARA_R4_H_INCLUDED
+#define _FAKE_SARA_R4_H_INCLUDED
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+class FakeSaraR4 : public HardwareSerial {
+public:
+    static const int NUM_SOCKETS = 7;
+    static const size_t MAX_READ_LENGTH = 1024;
+    static const size_t MAX_WRITE_LENGTH = 512;
+
+    struct Datagram {
+        std::string ip;
+        uint16_t port;
+        std::string data;
+    };
+
+    struct Reply {
+        std::vector<std::string> info;
+        std::string result;
+        unsigned long extraLatency;
+
+        Reply() : result("OK"), extraLatency(0) {}
+    };
+
+    struct Command {
+        std::string verb; // e.g. "AT+USORD"
+        char type;        // '=' set, '?' read, 't' test (=?), 0 action
+        std::vector<std::string> args;
+        std::string text;
+    };
+
+    typedef std::function<Reply(const Command &)> Handler;
+
+    explicit FakeSaraR4(unsigned long baud = 115200);
+
+    // HardwareSerial
+    void begin(unsigned long baud) override;
+
+    void end() override;
+
+    int available() override;
+
+    int read() override;
+
+    int peek() override;
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t *buf, size_t size) override;
+
+    using Print::write;
+
+    void flush() override;
+
+    // Timing model
+    unsigned long baud() const { return _baud; }
+
+    void setDefaultLatency(unsigned long ms) { _defaultLatencyMs = ms; }
+
+    void setLatency(const char *verb, unsigned long ms) { _latencyMs[verb] = ms; }
+
+    void setRegistrationDelay(unsigned long ms) { _registrationDelayMs = ms; }
+
+    // Most payload bytes an AT+USOWR is taken with, 0 for all of them
+    void setWriteLimit(size_t bytes) { _writeLimit = bytes; }
+
+    // TCP send buffer of the modem and the rate the peer acknowledges it with, 0 for instant acks
+    void setUplink(size_t bufferBytes, unsigned long bytesPerSecond);
+
+    // Scripting
+    void setHandler(const char *verb, Handler handler) { _handlers[verb] = handler; }
+
+    void failNext(const char *verb, const char *result = "ERROR") { _failures[verb].push_back(result); }
+
+    void sendUrc(const std::string &line, unsigned long delayMs = 0);
+
+    void deliverSms(const char *from, const char *text);
+
+    // Remote peers
+    void peerSend(int socket, const std::string &data, unsigned long delayMs = 0);
+
+    void peerSendFrom(int socket, const char *ip, uint16_t port, const std::string &data, unsigned long delayMs = 0);
+
+    void peerClose(int socket, unsigned long delayMs = 0);
+
+    // Close with +UUSOCL right away, like firmware that does not wait for the data to be read; the data stays readable
+    void peerCloseUnread(int socket, unsigned long delayMs = 0);
+
+    // Connect to a listening TCP socket, the module accepts it on a new socket and reports +UUSOLI
+    void peerConnect(int listeningSocket, const char *ip, uint16_t port, unsigned long delayMs = 0);
+
+    const std::string &peerReceived(int socket) const { return _sockets[socket].tx; }
+
+    void clearPeerReceived(int socket) { _sockets[socket].tx.clear(); }
+
+    const std::vector<Datagram> &datagramsSent() const { return _datagramsSent; }
+
+    // Introspection
+    bool socketOpen(int socket) const { return _sockets[socket].used; }
+
+    int lastCreatedSocket() const { return _lastCreatedSocket; }
+
+    bool socketConnected(int socket) const { return _sockets[socket].used && _sockets[socket].connected; }
+
+    unsigned long commandCount() const { return _commandCount; }
+
+    unsigned long commandCount(const char *verb) const;
+
+    const std::vector<std::string> &commandLog() const { return _commandLog; }
+
+    void clearLog();
+
+    uint64_t bytesFromHost() const { return _bytesFromHost; }
+
+    uint64_t bytesToHost() const { return _bytesToHost; }
+
+    // Polls of available() that found no data
+    unsigned long emptyPolls() const { return _emptyPolls; }
+
+    // Host power model: sleep until the next received byte, like a WFI woken by the UART interrupt
+    void sleep(unsigned long maxMs);
+
+    uint64_t sleptMicros() const { return _sleptMicros; }
+
+private:
+    struct Socket {
+        bool used;
+        int protocol;
+        bool connected;
+        bool peerClosed;
+        bool listening;
+        uint16_t localPort;
+        std::string rx;
+        std::deque<Datagram> rxDatagrams;
+        std::string tx;
+        size_t unacked;
+        uint64_t unackedAt;
+        std::map<std::pair<int, int>, std::pair<int, int> > options;
+
+        Socket() { reset(); }
+
+        void reset();
+    };
+
+    struct Chunk {
+        uint64_t start;
+        std::string data;
+        size_t pos;
+    };
+
+    struct Sms {
+        int index;
+        std::string from;
+        std::string text;
+        bool read;
+    };
+
+    enum {
+        INPUT_COMMAND,
+        INPUT_CERT_DATA,
+        INPUT_SMS_TEXT
+    } _inputMode;
+
+    unsigned long _baud;
+    unsigned long _defaultLatencyMs;
+    unsigned long _registrationDelayMs;
+    size_t _writeLimit;
+    size_t _uplinkBuffer;
+    unsigned long _uplinkRate;
+    std::map<std::string, unsigned long> _latencyMs;
+    std::map<std::string, Handler> _handlers;
+    std::map<std::string, std::deque<std::string> > _failures;
+
+    // simulated UART
+    uint64_t _txFreeAt;
+    uint64_t _rxFreeAt;
+    uint64_t _eventTime;
+    std::deque<Chunk> _rxChunks;
+    std::multimap<uint64_t, std::function<void()> > _events;
+
+    // modem state
+    std::string _line;
+    size_t _dataRemaining;
+    std::string _data;
+    std::string _certName;
+    int _cmee;
+    int _cfun;
+    uint64_t _cfunOnAt;
+    bool _attached;
+    bool _pinLocked;
+    std::string _pin;
+    int _nextSmsIndex;
+    int _nextSmsReference;
+    std::vector<Sms> _sms;
+    std::map<std::string, size_t> _certs;
+    int _lastCreatedSocket;
+    Socket _sockets[NUM_SOCKETS];
+    std::vector<Datagram> _datagramsSent;
+
+    // statistics
+    unsigned long _commandCount;
+    std::map<std::string, unsigned long> _verbCounts;
+    std::vector<std::string> _commandLog;
+    uint64_t _bytesFromHost;
+    uint64_t _bytesToHost;
+    unsigned long _emptyPolls;
+    uint64_t _sleptMicros;
+
+    uint64_t byteTimeMicros(size_t count) const;
+
+    void process();
+
+    void schedule(uint64_t at, std::function<void()> action);
+
+    void emit(const std::string &bytes);
+
+    void emitUrc(const std::string &line);
+
+    void emitReply(const Reply &reply);
+
+    void receive(const std::string &bytes);
+
+    void execute(const std::string &text);
+
+    Reply dispatch(const Command &command);
+
+    Reply error(int code, const char *text) const;
+
+    size_t unacked(int socket);
+
+    unsigned long latencyFor(const std::string &verb) const;
+
+    int registrationStatus() const;
+
+    void closeSocket(int socket);
+
+    static bool parse(const std::string &text, Command &command);
+
+    static std::string toHex(const std::string &data);
+
+    static bool fromHex(const std::string &hex, std::string &data);
+};
+
+#endif
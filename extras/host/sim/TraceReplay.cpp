@@ -0,0 +1,254 @@
+/*
+  Replays a UART trace recorded with ModemTrace against the host build.
+*/
+
+#include <string.h>
+
+#include <chrono>
+
+#include "TraceReplay.h"
+
+// Time allowed past the recorded response before a replayed command times out
+static const unsigned long REPLAY_SLACK_MS = 1000;
+
+TraceReplay::TraceReplay() :
+        _cursor(0),
+        _txPos(0),
+        _anchorMicros(0),
+        _anchorMillis(0),
+        _mismatches(0) {
+}
+
+bool TraceReplay::load(const std::string &trace, std::string &error) {
+    const uint8_t *data = (const uint8_t *) trace.data();
+    size_t size = trace.size();
+    size_t pos = 8;
+    unsigned long ms = 0;
+
+    _records.clear();
+
+    if (size < pos || memcmp(data, MODEM_TRACE_MAGIC, 4) != 0) {
+        error = "not a SARA-R4 trace";
+        return false;
+    }
+
+    while (pos < size) {
+        Record record;
+        size_t length = (data[pos] & 0x7f) + 1;
+        unsigned long delta = 0;
+        int shift = 0;
+
+        record.rx = (data[pos++] & MODEM_TRACE_RX) != 0;
+
+        do {
+            if (pos >= size || shift > 28) {
+                error = "truncated record header";
+                return false;
+            }
+
+            delta |= (unsigned long) (data[pos] & 0x7f) << shift;
+            shift += 7;
+        } while (data[pos++] & 0x80);
+
+        if (pos + length > size) {
+            error = "truncated record";
+            return false;
+        }
+
+        ms += delta;
+        record.ms = ms;
+        record.data.assign((const char *) data + pos, length);
+        pos += length;
+
+        _records.push_back(record);
+    }
+
+    _cursor = 0;
+    _txPos = 0;
+    _anchorMicros = hostMicros();
+    _anchorMillis = 0;
+    _rx.clear();
+    _mismatches = 0;
+
+    return true;
+}
+
+uint64_t TraceReplay::dueMicros(size_t record) const {
+    return _anchorMicros + (uint64_t) (_records[record].ms - _anchorMillis) * 1000;
+}
+
+void TraceReplay::release() {
+    while (_cursor < _records.size() && _records[_cursor].rx && hostMicros() >= dueMicros(_cursor)) {
+        _rx.insert(_rx.end(), _records[_cursor].data.begin(), _records[_cursor].data.end());
+        _cursor++;
+    }
+}
+
+int TraceReplay::nextTransmission() const {
+    for (size_t i = _cursor; i < _records.size(); i++) {
+        if (!_records[i].rx) {
+            return (int) i;
+        }
+    }
+
+    return -1;
+}
+
+int TraceReplay::available() {
+    release();
+
+    if (_rx.empty()) {
+        hostSpin();
+    }
+
+    return (int) _rx.size();
+}
+
+int TraceReplay::read() {
+    if (!available()) {
+        return -1;
+    }
+
+    uint8_t c = _rx.front();
+    _rx.pop_front();
+
+    return c;
+}
+
+int TraceReplay::peek() {
+    return available() ? _rx.front() : -1;
+}
+
+size_t TraceReplay::write(uint8_t c) {
+    // the host is ahead of the recording, the modem output it missed arrives now
+    while (_cursor < _records.size() && _records[_cursor].rx) {
+        _rx.insert(_rx.end(), _records[_cursor].data.begin(), _records[_cursor].data.end());
+        _cursor++;
+    }
+
+    if (_cursor == _records.size()) {
+        _mismatches++;
+        return 1;
+    }
+
+    const Record &record = _records[_cursor];
+
+    if ((uint8_t) record.data[_txPos] != c) {
+        _mismatches++;
+    }
+
+    if (++_txPos == record.data.size()) {
+        // modem output that followed this record is timed from now on
+        _anchorMicros = hostMicros();
+        _anchorMillis = record.ms;
+        _txPos = 0;
+        _cursor++;
+    }
+
+    return 1;
+}
+
+size_t TraceReplay::write(const uint8_t *buf, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        write(buf[i]);
+    }
+
+    return size;
+}
+
+class CountingUrcHandler : public ModemUrcHandler {
+public:
+    unsigned long count = 0;
+
+    void handleUrc(const char *) override { count++; }
+};
+
+// Consecutive bytes the recorded host sent
+struct Transmission {
+    size_t record;
+    std::string data;
+};
+
+static void pollUntil(TraceReplay &replay, Modem &modem, uint64_t due) {
+    while (hostMicros() < due) {
+        modem.poll();
+        modem.waitForData((unsigned long) ((due - hostMicros() + 999) / 1000));
+    }
+}
+
+void replayTrace(TraceReplay &replay, Modem &modem, ReplayReport &report) {
+    std::vector<Transmission> transmissions;
+    CountingUrcHandler urcs;
+
+    memset(&report, 0, sizeof(report));
+    modem.addUrcHandler(&urcs);
+
+    for (size_t i = 0; i < replay.records().size(); i++) {
+        const TraceReplay::Record &record = replay.records()[i];
+
+        if (record.rx) {
+            continue;
+        }
+
+        if (i > 0 && !replay.records()[i - 1].rx && !transmissions.empty()) {
+            transmissions.back().data += record.data;
+        } else {
+            transmissions.push_back({i, record.data});
+        }
+    }
+
+    uint64_t start = hostMicros();
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (size_t t = 0; t < transmissions.size(); t++) {
+        const Transmission &transmission = transmissions[t];
+        const Transmission *next = t + 1 < transmissions.size() ? &transmissions[t + 1] : nullptr;
+
+        pollUntil(replay, modem, replay.dueMicros(transmission.record));
+
+        if (transmission.data.compare(0, 2, "AT") != 0) {
+            // data answering a prompt, e.g. SMS text or a certificate
+            for (char c : transmission.data) {
+                modem.write((uint8_t) c);
+            }
+        } else {
+            std::string command = transmission.data.substr(0, transmission.data.find('\r'));
+
+            modem.send(command.c_str());
+            report.commands++;
+
+            if (next != nullptr && next->data.compare(0, 2, "AT") != 0) {
+                // the data is sent once the recorded host sent it
+                continue;
+            }
+        }
+
+        // wait as long as the recorded host did before its next transmission
+        uint64_t until = replay.dueMicros(next != nullptr ? next->record : replay.records().size() - 1);
+        unsigned long timeout = REPLAY_SLACK_MS;
+        if (until > hostMicros()) {
+            timeout += (unsigned long) ((until - hostMicros()) / 1000);
+        }
+
+        int result = modem.waitForResponse(timeout);
+        if (result > 0 && result <= MODEM_RESULT_PROMPT) {
+            report.results[result]++;
+        } else if (result < 0) {
+            report.timeouts++;
+        }
+    }
+
+    // URCs recorded after the last command
+    if (!replay.records().empty()) {
+        pollUntil(replay, modem, replay.dueMicros(replay.records().size() - 1));
+        modem.poll();
+    }
+
+    modem.removeUrcHandler(&urcs);
+
+    report.mismatches = replay.mismatches();
+    report.urcs = urcs.count;
+    report.recordedMillis = replay.durationMillis();
+    report.replayedMillis = (double) (hostMicros() - start) / 1000.0;
+    report.wallMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+}
@@ -0,0 +1,99 @@
+/*
+  Replays a UART trace recorded with ModemTrace against the host build.
+
+  TraceReplay is a HardwareSerial that plays the modem side of a recorded
+  trace: bytes the modem sent are delivered with their recorded timing,
+  relative to the last host transmission they followed, and bytes the host
+  writes are compared with the recorded ones. replayTrace() drives a Modem
+  through the commands of the trace, on the virtual clock of the Arduino shim,
+  so a trace replays deterministically and much faster than real time.
+*/
+
+#ifndef _TRACE_REPLAY_H_INCLUDED
+#define _TRACE_REPLAY_H_INCLUDED
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <Modem.h>
+
+class TraceReplay : public HardwareSerial {
+public:
+    struct Record {
+        bool rx;
+        unsigned long ms; // since the start of the trace
+        std::string data;
+    };
+
+    TraceReplay();
+
+    /** Parse a binary trace
+        @param trace    Trace, as written by ModemPrintTrace or ModemRingTrace::dump
+        @param error    Reason when the trace is invalid
+        @return true if the trace was loaded
+     */
+    bool load(const std::string &trace, std::string &error);
+
+    const std::vector<Record> &records() const { return _records; }
+
+    // HardwareSerial
+    void begin(unsigned long) override {}
+
+    void end() override {}
+
+    int available() override;
+
+    int read() override;
+
+    int peek() override;
+
+    size_t write(uint8_t c) override;
+
+    size_t write(const uint8_t *buf, size_t size) override;
+
+    using Print::write;
+
+    // Next record the host is expected to send, -1 once the trace is done
+    int nextTransmission() const;
+
+    // Virtual time at which the recorded host sent a record
+    uint64_t dueMicros(size_t record) const;
+
+    unsigned long mismatches() const { return _mismatches; }
+
+    unsigned long durationMillis() const { return _records.empty() ? 0 : _records.back().ms; }
+
+private:
+    std::vector<Record> _records;
+    size_t _cursor;
+    size_t _txPos;
+    uint64_t _anchorMicros;
+    unsigned long _anchorMillis;
+    std::deque<uint8_t> _rx;
+    unsigned long _mismatches;
+
+    void release();
+};
+
+struct ReplayReport {
+    unsigned long commands;
+    unsigned long results[MODEM_RESULT_PROMPT + 1];
+    unsigned long timeouts;
+    unsigned long mismatches;
+    unsigned long urcs;
+    unsigned long recordedMillis;
+    double replayedMillis;
+    double wallMicros;
+};
+
+/** Send the commands of a trace through a Modem attached to the replay
+    @param replay   Loaded trace
+    @param modem    Modem using replay as its serial port
+    @param report   Filled with the outcome of the replay
+ */
+void replayTrace(TraceReplay &replay, Modem &modem, ReplayReport &report);
+
+#endif
@@ -0,0 +1,72 @@
+/*
+  Replays a SARA-R4 UART trace, recorded with ModemPrintTrace or dumped
+  from a ModemRingTrace, through the host build of the library.
+
+  usage: sara_r4_replay <trace> [--stats]
+
+  Prints how the replayed commands completed, the number of bytes the
+  library sent that differ from the recording and the recorded, replayed
+  and host time. --stats adds the per command statistics of the Modem.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <Modem.h>
+
+#include "TraceReplay.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <trace> [--stats]\n", argv[0]);
+        return 2;
+    }
+
+    bool printStats = argc > 2 && strcmp(argv[2], "--stats") == 0;
+    std::ifstream file(argv[1], std::ios::binary);
+    std::stringstream contents;
+    std::string error;
+
+    if (!file) {
+        fprintf(stderr, "%s: can't open %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    contents << file.rdbuf();
+
+    TraceReplay replay;
+    if (!replay.load(contents.str(), error)) {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    Modem modem(replay, 115200, 255, 5);
+    ModemStats stats;
+    ReplayReport report;
+
+    modem.setStats(&stats);
+    replayTrace(replay, modem, report);
+
+    printf("records         %zu\n", replay.records().size());
+    printf("commands        %lu\n", report.commands);
+    printf("OK              %lu\n", report.results[MODEM_RESULT_OK]);
+    printf("ERROR           %lu\n", report.results[MODEM_RESULT_ERROR]);
+    printf("+CME ERROR      %lu\n", report.results[MODEM_RESULT_CME_ERROR]);
+    printf("+CMS ERROR      %lu\n", report.results[MODEM_RESULT_CMS_ERROR]);
+    printf("timeouts        %lu\n", report.timeouts);
+    printf("URCs            %lu\n", report.urcs);
+    printf("tx mismatches   %lu\n", report.mismatches);
+    printf("recorded        %lu ms\n", report.recordedMillis);
+    printf("replayed        %.1f ms (virtual)\n", report.replayedMillis);
+    printf("host            %.1f ms\n", report.wallMicros / 1000.0);
+
+    if (printStats) {
+        printf("\n");
+        stats.dump(Serial);
+    }
+
+    return report.timeouts || report.mismatches ? 1 : 0;
+}
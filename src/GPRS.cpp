@@ -52,7 +52,7 @@ NB_NetworkStatus_t GPRS::attachGPRS(bool synchronous) {
                 _state = ERROR;
                 break;
             }
-            delay(500);
+            _modem.waitForData(500);
         }
     } else {
         ready();
@@ -66,7 +66,7 @@ NB_NetworkStatus_t GPRS::detachGPRS(bool synchronous) {
 
     if (synchronous) {
         while (ready() == 0) {
-            delay(100);
+            _modem.waitForData(100);
         }
     } else {
         ready();
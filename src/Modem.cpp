@@ -22,6 +22,43 @@
 #define MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS 20
 #define LTE_RESET_PULSE_PERIOD 10000
 
+// Payload bytes sendHex() encodes per write to the UART
+#define MODEM_HEX_PIECE_SIZE 64
+
+// Received bytes poll() hands to the debug, stats and trace hooks at once
+#define MODEM_POLL_BURST_SIZE 64
+
+// Lines that terminate a command, matched once per received line
+static const struct {
+    const char *text;
+    uint8_t length;
+    uint8_t result;
+    bool hasErrorCode;
+} FINAL_RESULT_CODES[] = {
+        {"OK",          2,  MODEM_RESULT_OK,         false},
+        {"ERROR",       5,  MODEM_RESULT_ERROR,      false},
+        {"NO CARRIER",  10, MODEM_RESULT_NO_CARRIER, false},
+        {"+CME ERROR:", 11, MODEM_RESULT_CME_ERROR,  true},
+        {"+CMS ERROR:", 11, MODEM_RESULT_CMS_ERROR,  true},
+};
+
+// Verbose (AT+CMEE=2) texts of the +CME ERROR codes callers check for
+static const struct {
+    const char *text;
+    int code;
+} CME_ERROR_TEXTS[] = {
+        {"Operation not allowed",   MODEM_CME_OPERATION_NOT_ALLOWED},
+        {"Operation not supported", 4},
+        {"SIM not inserted",        10},
+        {"SIM PIN required",        11},
+        {"SIM PUK required",        12},
+        {"SIM failure",             13},
+        {"SIM busy",                14},
+        {"incorrect password",      16},
+        {"no network service",      30},
+        {"unknown",                 100},
+};
+
 Modem::Modem(Stream &uart, unsigned long baud, int resetPin, int powerOnPin,
              SerialStateUpdateHandler *handler) :
         _uart(&uart),
@@ -31,9 +68,23 @@ Modem::Modem(Stream &uart, unsigned long baud, int resetPin, int powerOnPin,
         _powerOnPin(powerOnPin),
         _lastResponseOrUrcMillis(0),
         _atCommandState(AT_COMMAND_IDLE),
-        _ready(1),
-        _responseDataStorage(nullptr) {
-    _buffer.reserve(64);
+        _ready(MODEM_RESULT_OK),
+        _errorCode(-1),
+        _promptExpected(false),
+        _responseDataStorage(nullptr),
+        _pendingEmptyLines(0),
+        _queueHead(0),
+        _queueCount(0),
+        _queueActive(false),
+        _queueHeld(false),
+        _queueSentMillis(0),
+        _savedReady(MODEM_RESULT_OK),
+        _savedErrorCode(-1),
+        _savedResponseDataStorage(nullptr),
+        _socketTable(*this) {
+    addUrcHandler(&_socketTable, "+UUSORD");
+    addUrcHandler(&_socketTable, "+UUSORF");
+    addUrcHandler(&_socketTable, "+UUSOCL");
 }
 
 template<class T>
@@ -141,18 +192,49 @@ int Modem::reset() {
 }
 
 size_t Modem::write(uint8_t c) {
-    return _uart->write(c);
+    if (_ready == MODEM_RESULT_PROMPT) {
+        // the data answers the prompt, the command now runs to its final result
+        _ready = MODEM_RESULT_PENDING;
+    }
+
+    size_t result = _uart->write(c);
+
+    if (_stats) {
+        _stats->addBytesSent(result);
+    }
+
+    if (_trace) {
+        _trace->record(MODEM_TRACE_TX, &c, result, millis());
+    }
+
+    return result;
 }
 
 size_t Modem::write(const uint8_t *buf, size_t size) {
+    if (_ready == MODEM_RESULT_PROMPT) {
+        _ready = MODEM_RESULT_PENDING;
+    }
+
     size_t result = _uart->write(buf, size);
 
+    if (_stats) {
+        _stats->addBytesSent(result);
+    }
+
+    if (_trace) {
+        _trace->record(MODEM_TRACE_TX, buf, result, millis());
+    }
+
     // the R410m echos the binary data, when we don't what it to so
     size_t ignoreCount = 0;
 
     while (ignoreCount < result) {
         if (_uart->available()) {
-            _uart->read();
+            uint8_t c = _uart->read();
+
+            if (_trace) {
+                _trace->record(MODEM_TRACE_RX, &c, 1, millis());
+            }
 
             ignoreCount++;
         }
@@ -181,17 +263,79 @@ size_t Modem::write_P(const uint8_t *raw_PGM, size_t size) {
 }
 
 void Modem::send(const char *command) {
+    waitForQueue();
+    transmit(command);
+}
+
+void Modem::sendHex(const char *command, const NBSegment *segments, size_t count, size_t offset, size_t length,
+                    const char *suffix) {
+    waitForQueue();
+    transmit(command, segments, count, offset, length, suffix);
+}
+
+void Modem::waitForQueue() {
+    // a queued command on the line has to complete first, the rest of the queue waits
+    _queueHeld = true;
+    while (_queueActive) {
+        poll();
+
+        if (_queueActive) {
+            waitForData(_queue[_queueHead].timeout);
+        }
+    }
+    _queueHeld = false;
+}
+
+void Modem::transmitPart(const char *data, size_t length) {
+    _uart->write((const uint8_t *) data, length);
+
+    if (_stats) {
+        _stats->addBytesSent(length);
+    }
+
+    if (_trace) {
+        _trace->record(MODEM_TRACE_TX, (const uint8_t *) data, length, millis());
+    }
+}
+
+void Modem::transmit(const char *command, const NBSegment *segments, size_t count, size_t offset, size_t length,
+                     const char *suffix) {
     // compare the time of the last response or URC and ensure
     // at least 20ms have passed before sending a new command
     unsigned long delta = millis() - _lastResponseOrUrcMillis;
     if (delta < MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS) {
         delay(MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS - delta);
+
+        if (_stats) {
+            _stats->addGuardMillis(MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS - delta);
+        }
     }
 
-    _uart->println(command);
+    transmitPart(command, strlen(command));
+
+    for (size_t sent = 0; sent < length;) {
+        char hex[NB_HEX_LENGTH(MODEM_HEX_PIECE_SIZE)];
+        size_t piece = length - sent < MODEM_HEX_PIECE_SIZE ? length - sent : MODEM_HEX_PIECE_SIZE;
+
+        transmitPart(hex, NBHex::encode(segments, count, offset + sent, piece, hex));
+        sent += piece;
+    }
+
+    if (suffix != nullptr) {
+        transmitPart(suffix, strlen(suffix));
+    }
+
+    transmitPart("\r\n", 2);
     _uart->flush();
+
+    if (_stats) {
+        _stats->commandSent(command, micros());
+    }
     _atCommandState = AT_COMMAND_IDLE;
-    _ready = 0;
+    _ready = MODEM_RESULT_PENDING;
+    _errorCode = -1;
+    _pendingEmptyLines = 0;
+    _promptExpected = false;
 }
 
 void Modem::sendf(const char *fmt, ...) {
@@ -205,124 +349,468 @@ void Modem::sendf(const char *fmt, ...) {
     send(buf);
 }
 
+void Modem::setTrace(ModemTrace *trace) {
+    if (_trace) {
+        _trace->flush();
+    }
+
+    _trace = trace;
+}
+
+void Modem::setIdleHook(ModemIdleHook hook, void *context) {
+    _idleHook = hook;
+    _idleHookContext = context;
+}
+
+bool Modem::waitForData(unsigned long timeout) {
+    for (unsigned long start = millis(); !_uart->available();) {
+        unsigned long elapsed = millis() - start;
+
+        if (elapsed >= timeout) {
+            return false;
+        }
+
+        unsigned long maxSleep = timeout - elapsed;
+
+        // a queued command waiting for the guard time or its final result needs poll() in time
+        if (_queueActive || (_queueCount && !_queueHeld &&
+                             _ready != MODEM_RESULT_PENDING && _ready != MODEM_RESULT_PROMPT)) {
+            unsigned long deadline = _queueActive ? _queue[_queueHead].timeout : MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS;
+            unsigned long since = millis() - (_queueActive ? _queueSentMillis : _lastResponseOrUrcMillis);
+
+            if (since >= deadline) {
+                return false;
+            } else if (deadline - since < maxSleep) {
+                maxSleep = deadline - since;
+            }
+        }
+
+        if (_idleHook != nullptr) {
+            _idleHook(maxSleep, _idleHookContext);
+        } else {
+            yield();
+        }
+    }
+
+    return true;
+}
+
 int Modem::waitForPrompt(unsigned long timeout) {
+    expectPrompt();
+
     for (unsigned long start = millis(); (millis() - start) < timeout;) {
-        while (_uart->available()) {
-            char c = _uart->read();
-            if (_debugPrint) {
-                _debugPrint->print(c);
-            }
+        int r = ready();
 
-            _buffer += c;
+        if (r == MODEM_RESULT_PROMPT) {
+            return 1;
+        } else if (r != MODEM_RESULT_PENDING) {
+            break;
+        }
 
-            if (_buffer.endsWith(">")) {
-                return 1;
-            }
+        unsigned long elapsed = millis() - start;
+        if (elapsed < timeout) {
+            waitForData(timeout - elapsed);
         }
     }
     return -1;
 }
 
 int Modem::waitForResponse(unsigned long timeout, String *responseDataStorage) {
-    _responseDataStorage = responseDataStorage;
+    setResponseDataStorage(responseDataStorage);
     for (unsigned long start = millis(); (millis() - start) < timeout;) {
         int r = ready();
 
         if (r != 0) {
-            _responseDataStorage = nullptr;
+            // a queued command may be on the line already, keep its storage
+            if (_queueActive) {
+                _savedResponseDataStorage = nullptr;
+            } else {
+                _responseDataStorage = nullptr;
+            }
             return r;
         }
+
+        unsigned long elapsed = millis() - start;
+        if (elapsed < timeout) {
+            waitForData(timeout - elapsed);
+        }
     }
 
     _responseDataStorage = nullptr;
-    _buffer = "";
+    _lineBuffer.clear();
+
+    if (_stats) {
+        _stats->commandTimedOut();
+    }
     return -1;
 }
 
 int Modem::ready() {
     poll();
 
-    return _ready;
+    // while a queued command executes the result of the last sent command is kept aside
+    return _queueActive ? _savedReady : _ready;
 }
 
-void Modem::poll() {
-    while (_uart->available()) {
-        char c = _uart->read();
+bool Modem::enqueue(const char *command, unsigned long timeout, ModemCommandCallback callback, void *context) {
+    if (_queueCount >= MODEM_COMMAND_QUEUE_SIZE || strlen(command) > MODEM_COMMAND_QUEUE_COMMAND_LENGTH) {
+        return false;
+    }
+
+    QueuedCommand &queued = _queue[(_queueHead + _queueCount) % MODEM_COMMAND_QUEUE_SIZE];
+
+    strcpy(queued.command, command);
+    queued.timeout = timeout;
+    queued.callback = callback;
+    queued.context = context;
+    _queueCount++;
+
+    pollQueue();
+
+    return true;
+}
+
+void Modem::cancel(void *context) {
+    int kept = 0;
+
+    for (int i = 0; i < _queueCount; i++) {
+        QueuedCommand &queued = _queue[(_queueHead + i) % MODEM_COMMAND_QUEUE_SIZE];
+
+        if (queued.context == context) {
+            // the modem already works on the executing command
+            if (i > 0 || !_queueActive) {
+                continue;
+            }
+            queued.callback = nullptr;
+        }
 
-        if (_debugPrint) {
-            _debugPrint->write(c);
+        if (kept != i) {
+            _queue[(_queueHead + kept) % MODEM_COMMAND_QUEUE_SIZE] = queued;
         }
+        kept++;
+    }
 
-        _buffer += c;
+    _queueCount = kept;
+}
 
-        switch (_atCommandState) {
-            case AT_COMMAND_IDLE:
-            default: {
+void Modem::pollQueue() {
+    if (_queueActive) {
+        int result = _ready;
 
-                if (_buffer.startsWith("AT") && _buffer.endsWith("\r\n")) {
-                    _atCommandState = AT_RECEIVING_RESPONSE;
-                    _buffer = "";
-                } else if (_buffer.endsWith("\r\n")) {
-                    _buffer.trim();
+        if (result == MODEM_RESULT_PENDING) {
+            if ((millis() - _queueSentMillis) < _queue[_queueHead].timeout) {
+                return;
+            }
 
-                    if (_buffer.length()) {
-                        _lastResponseOrUrcMillis = millis();
+            _atCommandState = AT_COMMAND_IDLE;
+            _lineBuffer.clear();
+            result = -1;
 
-                        for (auto const & _urcHandler : _urcHandlers) {
-                            if (_urcHandler != nullptr) {
-                                _urcHandler->handleUrc(_buffer);
-                            }
-                        }
-                    }
+            if (_stats) {
+                _stats->commandTimedOut();
+            }
+        }
 
-                    _buffer = "";
-                }
+        QueuedCommand &completed = _queue[_queueHead];
+        ModemCommandCallback callback = completed.callback;
+        void *context = completed.context;
+
+        _queueHead = (_queueHead + 1) % MODEM_COMMAND_QUEUE_SIZE;
+        _queueCount--;
+        _queueActive = false;
+
+        _ready = _savedReady;
+        _errorCode = _savedErrorCode;
+        _responseDataStorage = _savedResponseDataStorage;
+
+        if (callback != nullptr) {
+            callback(result, _queueResponse, context);
+        }
+
+        // the completed command made room for closes a full queue deferred
+        _socketTable.retryCloses();
+    }
+
+    // start the next command as soon as the line is free
+    if (_queueActive || _queueHeld || _queueCount == 0 ||
+        _ready == MODEM_RESULT_PENDING || _ready == MODEM_RESULT_PROMPT) {
+        return;
+    }
 
+    // wait for the guard time after the last response on a later poll instead of blocking in transmit()
+    if ((millis() - _lastResponseOrUrcMillis) < MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS) {
+        return;
+    }
+
+    _savedReady = _ready;
+    _savedErrorCode = _errorCode;
+    _savedResponseDataStorage = _responseDataStorage;
+
+    _queueResponse = "";
+    _responseDataStorage = &_queueResponse;
+    _queueActive = true;
+
+    transmit(_queue[_queueHead].command);
+    _queueSentMillis = millis();
+}
+
+void Modem::poll() {
+    char burst[MODEM_POLL_BURST_SIZE];
+    size_t count = 0;
+    bool stop = false;
+
+    for (int available = _uart->available(); available > 0 && !stop; available = _uart->available()) {
+        for (; available > 0; available--) {
+            char c = _uart->read();
+
+            burst[count++] = c;
+
+            if (_promptExpected && (c == '>' || c == '@') && _atCommandState == AT_RECEIVING_RESPONSE &&
+                _lineBuffer.atLineStart()) {
+                _promptExpected = false;
+                _ready = MODEM_RESULT_PROMPT;
+                stop = true;
                 break;
             }
 
-            case AT_RECEIVING_RESPONSE: {
-                if (c == '\n') {
-                    _lastResponseOrUrcMillis = millis();
-                    int responseResultIndex;
-
-                    if ((responseResultIndex = _buffer.lastIndexOf("OK\r\n")) != -1) {
-                        _ready = 1;
-                    } else if ((responseResultIndex = _buffer.lastIndexOf("ERROR\r\n")) != -1) {
-                        _ready = 2;
-                    } else if ((responseResultIndex = _buffer.lastIndexOf("NO CARRIER\r\n")) != -1) {
-                        _ready = 3;
-                    } else if ((responseResultIndex = _buffer.lastIndexOf("CME ERROR")) != -1) {
-                        _ready = 4;
+            if (_lineBuffer.feed(c)) {
+                // the hooks see a line before anything it triggers
+                received(burst, count);
+                count = 0;
+
+                if (processLine()) {
+                    stop = true;
+                    break;
+                }
+            } else if (count == sizeof(burst)) {
+                received(burst, count);
+                count = 0;
+            }
+        }
+    }
+
+    received(burst, count);
+    pollQueue();
+}
+
+void Modem::received(const char *data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+
+    if (_debugPrint) {
+        _debugPrint->write((const uint8_t *) data, length);
+    }
+
+    if (_stats) {
+        _stats->addBytesReceived(length);
+    }
+
+    if (_trace) {
+        _trace->record(MODEM_TRACE_RX, (const uint8_t *) data, length, millis());
+    }
+}
+
+ModemResult Modem::classifyLine() {
+    size_t length = _lineBuffer.length();
+    const char *line = _lineBuffer.line();
+
+    if (length < 2 || (line[0] != 'O' && line[0] != 'E' && line[0] != 'N' && line[0] != '+')) {
+        return MODEM_RESULT_PENDING;
+    }
+
+    for (auto const &code : FINAL_RESULT_CODES) {
+        if (code.hasErrorCode ? length < code.length : length != code.length) {
+            continue;
+        }
+
+        if (memcmp(line, code.text, code.length) != 0) {
+            continue;
+        }
+
+        if (code.hasErrorCode) {
+            const char *text = line + code.length;
+
+            while (*text == ' ') {
+                text++;
+            }
+
+            if (*text >= '0' && *text <= '9') {
+                _errorCode = atoi(text);
+            } else {
+                for (auto const &error : CME_ERROR_TEXTS) {
+                    if (strcmp(text, error.text) == 0) {
+                        _errorCode = error.code;
+                        break;
                     }
+                }
+            }
+        }
+
+        return (ModemResult) code.result;
+    }
+
+    return MODEM_RESULT_PENDING;
+}
 
-                    if (_ready != 0) {
-                        if (_responseDataStorage != nullptr) {
-                            if (_ready > 1) {
-                                _buffer.substring(responseResultIndex);
-                            } else {
-                                _buffer.remove(responseResultIndex);
-                            }
-                            _buffer.trim();
+bool Modem::processLine() {
+    // a truncated line would be taken for a complete one, e.g. +USORD with part of its hex
+    if (_lineBuffer.overflowed()) {
+        _lastResponseOrUrcMillis = millis();
 
-                            *_responseDataStorage = _buffer;
+        if (_stats) {
+            _stats->lineOverflowed();
+        }
 
-                            _responseDataStorage = nullptr;
-                        }
+        return false;
+    }
 
-                        _atCommandState = AT_COMMAND_IDLE;
-                        _buffer = "";
-                        return;
+    switch (_atCommandState) {
+        case AT_COMMAND_IDLE:
+        default: {
+            if (_lineBuffer.startsWith("AT")) {
+                _atCommandState = AT_RECEIVING_RESPONSE;
+                _pendingEmptyLines = 0;
+            } else if (_lineBuffer.length()) {
+                _lastResponseOrUrcMillis = millis();
+
+                const char *urc = _lineBuffer.trim();
+                if (*urc) {
+                    if (_stats) {
+                        _stats->urcReceived();
                     }
+
+                    dispatchUrc(urc);
                 }
+            }
+
+            break;
+        }
+
+        case AT_RECEIVING_RESPONSE: {
+            _lastResponseOrUrcMillis = millis();
+
+            // u-blox URCs (+UUSORD, +UUSOCL, ...) can arrive between the lines of a response
+            if (_lineBuffer.startsWith("+UU")) {
+                if (_stats) {
+                    _stats->urcReceived();
+                }
+
+                dispatchUrc(_lineBuffer.trim());
+                break;
+            }
+
+            _ready = classifyLine();
+
+            if (_ready == MODEM_RESULT_PENDING) {
+                storeResponseLine();
                 break;
             }
+
+            if (_stats) {
+                _stats->commandCompleted(_ready, micros());
+            }
+
+            if (_responseDataStorage != nullptr) {
+                if (_ready > MODEM_RESULT_OK) {
+                    // errors keep the result line, callers look for the error text
+                    storeResponseLine();
+                }
+                _responseDataStorage->trim();
+
+                _responseDataStorage = nullptr;
+            }
+
+            _atCommandState = AT_COMMAND_IDLE;
+            return true;
         }
     }
+
+    return false;
+}
+
+void Modem::storeResponseLine() {
+    if (_responseDataStorage == nullptr) {
+        return;
+    }
+
+    if (_lineBuffer.length() == 0) {
+        // empty lines only matter between two lines of content
+        if (_responseDataStorage->length()) {
+            _pendingEmptyLines++;
+        }
+        return;
+    }
+
+    if (_responseDataStorage->length()) {
+        _responseDataStorage->concat("\r\n");
+    }
+
+    for (; _pendingEmptyLines > 0; _pendingEmptyLines--) {
+        _responseDataStorage->concat("\r\n");
+    }
+
+    _responseDataStorage->concat(_lineBuffer.line(), _lineBuffer.length());
 }
 
 void Modem::setResponseDataStorage(String *responseDataStorage) {
+    // the response is assembled line by line as it arrives
+    if (responseDataStorage != nullptr) {
+        *responseDataStorage = "";
+    }
+
+    if (_queueActive) {
+        // the storage is for the next sent command, the queued one keeps its own
+        _savedResponseDataStorage = responseDataStorage;
+        return;
+    }
+
     _responseDataStorage = responseDataStorage;
+    _pendingEmptyLines = 0;
+}
+
+void Modem::dispatchUrc(const char *urc) {
+    for (auto const & _urcHandler : _urcHandlers) {
+        if (_urcHandler != nullptr) {
+            _urcHandler->handleUrc(urc);
+        }
+    }
+
+    const char *colon = strchr(urc, ':');
+    if (colon == nullptr) {
+        return;
+    }
+
+    size_t length = colon - urc;
+
+    for (auto const &route : _urcRoutes) {
+        if (route.length != length || route.prefix == nullptr || memcmp(route.prefix, urc, length) != 0) {
+            continue;
+        }
+
+        if (route.socketHandlerCount) {
+            const char *param = colon + 1;
+
+            while (*param == ' ') {
+                param++;
+            }
+
+            unsigned int socket = *param - '0';
+            if (socket < MODEM_NUM_SOCKETS && (param[1] == ',' || param[1] == '\0') &&
+                route.socketHandlers[socket] != nullptr) {
+                route.socketHandlers[socket]->handleUrc(urc);
+            }
+        }
+
+        for (auto const listener : route.listeners) {
+            if (listener != nullptr) {
+                listener->handleUrc(urc);
+            }
+        }
+
+        // prefixes are unique in the table
+        return;
+    }
 }
 
 void Modem::addUrcHandler(ModemUrcHandler *handler) {
@@ -334,6 +822,60 @@ void Modem::addUrcHandler(ModemUrcHandler *handler) {
     }
 }
 
+bool Modem::addUrcHandler(ModemUrcHandler *handler, const char *prefix, int socket) {
+    if (socket >= MODEM_NUM_SOCKETS) {
+        return false;
+    }
+
+    size_t length = strlen(prefix);
+    UrcRoute *route = nullptr;
+
+    for (auto &candidate : _urcRoutes) {
+        if (candidate.prefix != nullptr && candidate.length == length && memcmp(candidate.prefix, prefix, length) == 0) {
+            route = &candidate;
+            break;
+        } else if (candidate.prefix == nullptr && route == nullptr) {
+            route = &candidate;
+        }
+    }
+
+    if (route == nullptr) {
+        return false;
+    }
+
+    if (socket >= 0) {
+        if (route->socketHandlers[socket] != nullptr && route->socketHandlers[socket] != handler) {
+            return false;
+        }
+
+        if (route->socketHandlers[socket] == nullptr) {
+            route->socketHandlers[socket] = handler;
+            route->socketHandlerCount++;
+        }
+    } else {
+        ModemUrcHandler **slot = nullptr;
+
+        for (auto &listener : route->listeners) {
+            if (listener == handler) {
+                return true;
+            } else if (listener == nullptr && slot == nullptr) {
+                slot = &listener;
+            }
+        }
+
+        if (slot == nullptr) {
+            return false;
+        }
+
+        *slot = handler;
+    }
+
+    route->prefix = prefix;
+    route->length = length;
+
+    return true;
+}
+
 void Modem::removeUrcHandler(ModemUrcHandler *handler) {
     for (auto & _urcHandler : _urcHandlers) {
         if (_urcHandler == handler) {
@@ -341,6 +883,30 @@ void Modem::removeUrcHandler(ModemUrcHandler *handler) {
             break;
         }
     }
+
+    for (auto &route : _urcRoutes) {
+        bool used = false;
+
+        for (auto &socketHandler : route.socketHandlers) {
+            if (socketHandler == handler) {
+                socketHandler = nullptr;
+                route.socketHandlerCount--;
+            }
+            used |= socketHandler != nullptr;
+        }
+
+        for (auto &listener : route.listeners) {
+            if (listener == handler) {
+                listener = nullptr;
+            }
+            used |= listener != nullptr;
+        }
+
+        if (!used) {
+            route.prefix = nullptr;
+            route.length = 0;
+        }
+    }
 }
 
 void Modem::setBaudRate(unsigned long baud) {
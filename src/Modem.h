@@ -25,6 +25,7 @@
 
 #include <Arduino.h>
 
+#include "utility/NBHex.h"
 
 
 #ifdef ARDUINO_ARCH_AVR                    // Arduino AVR boards (Uno, Pro Micro, etc.)
@@ -51,13 +52,89 @@
 #include <SoftwareSerial.h>
 #endif
 
+#include "utility/ModemLineBuffer.h"
+#include "utility/ModemStats.h"
+#include "utility/ModemTrace.h"
 
 
+
+// Final result of the last command, as returned by ready() and waitForResponse()
+enum ModemResult {
+    MODEM_RESULT_PENDING = 0,
+    MODEM_RESULT_OK = 1,
+    MODEM_RESULT_ERROR = 2,
+    MODEM_RESULT_NO_CARRIER = 3,
+    MODEM_RESULT_CME_ERROR = 4,
+    MODEM_RESULT_CMS_ERROR = 5,
+    MODEM_RESULT_PROMPT = 6
+};
+
+// +CME ERROR codes the library reacts to
+#define MODEM_CME_OPERATION_NOT_ALLOWED 3
+
+// Sockets the SARA-R4 module can have open at the same time
+#ifndef MODEM_NUM_SOCKETS
+#define MODEM_NUM_SOCKETS 7
+#endif
+
+// Distinct URC prefixes handlers can register for
+#ifndef MAX_URC_PREFIXES
+#define MAX_URC_PREFIXES 6
+#endif
+
+// Handlers of one URC prefix that are not bound to a socket
+#ifndef MAX_URC_LISTENERS
+#define MAX_URC_LISTENERS 2
+#endif
+
+// Handlers receiving every URC
+#ifndef MAX_URC_HANDLERS
+#define MAX_URC_HANDLERS 8
+#endif
+
+// Commands that can wait in the command queue, including the one executing
+#ifndef MODEM_COMMAND_QUEUE_SIZE
+#define MODEM_COMMAND_QUEUE_SIZE 4
+#endif
+
+// Longest queued command, without the terminating NUL
+#ifndef MODEM_COMMAND_QUEUE_COMMAND_LENGTH
+#define MODEM_COMMAND_QUEUE_COMMAND_LENGTH 63
+#endif
+
+/** Called when a queued command completes
+    @param result   Final result (see ModemResult), -1 on timeout
+    @param response Response lines of the command
+    @param context  Context passed to Modem::enqueue
+ */
+typedef void (*ModemCommandCallback)(int result, const String &response, void *context);
+
+/** Called while the library waits for the modem
+    The hook can sleep, feed a watchdog or service other work, a hook that sleeps
+    should wake up on received UART data.
+    @param maxSleepMs   Time after which the library has to run again, in milliseconds
+    @param context      Context passed to Modem::setIdleHook
+ */
+typedef void (*ModemIdleHook)(unsigned long maxSleepMs, void *context);
+
 class ModemUrcHandler {
 public:
-    virtual void handleUrc(const String &urc) = 0;
+    /** Handle an unsolicited result code
+        Override this one, the default passes the URC on to the String overload.
+        @param urc      URC line, without surrounding whitespace
+     */
+    virtual void handleUrc(const char *urc) { handleUrc(String(urc)); }
+
+    /** Handle an unsolicited result code as a String
+        Deprecated, kept so handlers written for the String signature still receive URCs,
+        each URC costs them a String copy.
+        @param urc      URC line, without surrounding whitespace
+     */
+    virtual void handleUrc(const String & /*urc*/) {}
 };
 
+#include "utility/NBSocketTable.h"
+
 struct SerialState {
     unsigned long baud;
     bool isBegin;
@@ -109,18 +186,120 @@ public:
 
     void sendf(const char *fmt, ...);
 
+    /** Send a command carrying a payload, hex encoded straight to the UART in small pieces
+        so no buffer for the whole command is needed, e.g. AT+USOWR=0,5,"<hex>"
+        @param command  Command up to the payload, e.g. AT+USOWR=0,5,"
+        @param segments Payload, in one or more buffers
+        @param count    Number of segments
+        @param offset   Position of the first byte to send in the segments
+        @param length   Number of bytes to send
+        @param suffix   Text after the payload, e.g. the closing quote
+     */
+    void sendHex(const char *command, const NBSegment *segments, size_t count, size_t offset, size_t length,
+                 const char *suffix);
+
+    /** Set the hook run while waiting for the modem, yield() is called without one
+        @param hook     Hook, nullptr to remove it
+        @param context  Passed to the hook
+     */
+    void setIdleHook(ModemIdleHook hook, void *context = nullptr);
+
+    /** Record per command statistics, not recorded by default
+        @param stats    Statistics to update, nullptr to stop recording
+     */
+    void setStats(ModemStats *stats) { _stats = stats; }
+
+    ModemStats *stats() const { return _stats; }
+
+    /** Record all bytes sent to and received from the modem, not recorded by default
+        @param trace    Trace to record to, nullptr to stop recording
+     */
+    void setTrace(ModemTrace *trace);
+
+    /** Get the state and receive buffers of the sockets of the modem
+        @return socket table shared by all clients of this modem
+     */
+    NBSocketTable &sockets() { return _socketTable; }
+
+    /** Wait for data from the modem, running the idle hook in between
+        @param timeout  Maximum time to wait, in milliseconds
+        @return true if data is available
+     */
+    bool waitForData(unsigned long timeout);
+
+    /** Let the command just sent be answered with a '>' or '@' prompt
+        Until send() is called again a line starting with either character
+        completes it with MODEM_RESULT_PROMPT, waitForPrompt() does this itself.
+     */
+    void expectPrompt() { _promptExpected = true; }
+
     int waitForPrompt(unsigned long timeout = 500);
 
     int waitForResponse(unsigned long timeout = 200, String *responseDataStorage = nullptr);
 
+    /** Queue a command, it is sent as soon as the modem is free
+        Queued commands run back-to-back from poll(), commands issued with send()
+        wait for the executing queued command. Queued commands can't use a prompt.
+        @param command  Command, copied into the queue
+        @param timeout  Time to wait for the final result, in milliseconds
+        @param callback Called with the result and response, can queue further commands
+        @param context  Passed to the callback
+        @return true if the command was queued, false if the queue is full or the command too long
+     */
+    bool enqueue(const char *command, unsigned long timeout, ModemCommandCallback callback = nullptr,
+                 void *context = nullptr);
+
+    /** Drop queued commands, e.g. before their context goes away
+        Commands not sent yet are removed, the executing one still completes
+        but without its callback.
+        @param context  Context the commands were queued with
+     */
+    void cancel(void *context);
+
+    /** Check if the executing queued command was queued with a context
+        @param context  Context the command was queued with
+        @return true until its callback was called
+     */
+    bool executing(const void *context) const { return _queueActive && _queue[_queueHead].context == context; }
+
+    /** Get the number of queued commands
+        @return commands waiting or executing
+     */
+    int queued() const { return _queueCount; }
+
     int ready();
 
+    /** Get the typed final result of the last command
+        @return MODEM_RESULT_PENDING while the command is still executing
+     */
+    ModemResult lastResult() const { return (ModemResult) (_queueActive ? _savedReady : _ready); }
+
+    /** Get the error code reported with the last +CME ERROR or +CMS ERROR
+        Like lastResult(), it belongs to the last sent command, queued commands leave it alone.
+        @return error code, -1 if none was reported or it was not recognized
+     */
+    int lastErrorCode() const { return _queueActive ? _savedErrorCode : _errorCode; }
+
     void poll();
 
     void setResponseDataStorage(String *responseDataStorage);
 
+    /** Register a handler for every URC
+        @param handler  Handler
+     */
     void addUrcHandler(ModemUrcHandler *handler);
 
+    /** Register a handler for the URCs starting with a prefix
+        @param handler  Handler
+        @param prefix   URC name up to the colon, e.g. "+UUSORD", must stay valid while registered
+        @param socket   Only route URCs whose first parameter is this socket, -1 for any
+        @return true if the handler was registered, false if the routing table is full
+     */
+    bool addUrcHandler(ModemUrcHandler *handler, const char *prefix, int socket = -1);
+
+    /** Unregister all routes of a handler
+        @param handler  Handler
+     */
     void removeUrcHandler(ModemUrcHandler *handler);
 
     void setBaudRate(unsigned long baud);
@@ -138,12 +317,58 @@ private:
         AT_RECEIVING_RESPONSE
     } _atCommandState;
     int _ready;
-    String _buffer;
+    int _errorCode;
+    bool _promptExpected;
+    ModemLineBuffer _lineBuffer;
     String *_responseDataStorage;
-
-#define MAX_URC_HANDLERS 8 // 7 sockets + GPRS
+    int _pendingEmptyLines;
+
+    struct UrcRoute {
+        const char *prefix;
+        uint8_t length;
+        uint8_t socketHandlerCount;
+        ModemUrcHandler *socketHandlers[MODEM_NUM_SOCKETS];
+        ModemUrcHandler *listeners[MAX_URC_LISTENERS];
+    };
+
+    struct QueuedCommand {
+        char command[MODEM_COMMAND_QUEUE_COMMAND_LENGTH + 1];
+        unsigned long timeout;
+        ModemCommandCallback callback;
+        void *context;
+    };
+
+    QueuedCommand _queue[MODEM_COMMAND_QUEUE_SIZE];
+    uint8_t _queueHead;
+    uint8_t _queueCount;
+    bool _queueActive;
+    bool _queueHeld;
+    unsigned long _queueSentMillis;
+    int _savedReady;
+    int _savedErrorCode;
+    String *_savedResponseDataStorage;
+    String _queueResponse;
+
+    UrcRoute _urcRoutes[MAX_URC_PREFIXES] = {};
     ModemUrcHandler *_urcHandlers[MAX_URC_HANDLERS] = {nullptr};
     Print *_debugPrint = nullptr;
+    ModemStats *_stats = nullptr;
+    ModemTrace *_trace = nullptr;
+    ModemIdleHook _idleHook = nullptr;
+    void *_idleHookContext = nullptr;
+    NBSocketTable _socketTable;
+
+    bool processLine();
+
+    void received(const char *data, size_t length);
+    ModemResult classifyLine();
+    void storeResponseLine();
+    void dispatchUrc(const char *urc);
+    void transmit(const char *command, const NBSegment *segments = nullptr, size_t count = 0, size_t offset = 0,
+                  size_t length = 0, const char *suffix = nullptr);
+    void transmitPart(const char *data, size_t length);
+    void waitForQueue();
+    void pollQueue();
 
     void powerOn(bool restart) const;
     void powerOff() const;
@@ -95,7 +95,7 @@ NB_NetworkStatus_t NB::begin(const char *pin, const char *apn, const char *usern
                     break;
                 }
 
-                delay(100);
+                _modem.waitForData(100);
             }
         } else {
             return (NB_NetworkStatus_t) 0;
@@ -17,16 +17,31 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "Modem.h"
 
-#include "utility/NBSocketBuffer.h"
+#include "utility/NBHex.h"
 
 #include "NBClient.h"
 
+// Longest single wait for the modem before the client state is checked again
+#define NB_CLIENT_WAIT_TIMEOUT 1000
+
+// How often and for how long a sync write asks the modem whether the send window opened
+#define NB_CLIENT_SEND_WINDOW_POLL_INTERVAL 100
+#define NB_CLIENT_SEND_WINDOW_TIMEOUT 10000
+
+// Time an AT+USOSO or AT+USOGO may take, in milliseconds
+#define NB_CLIENT_OPTION_TIMEOUT 1000
+
 enum {
     CLIENT_STATE_IDLE,
     CLIENT_STATE_CREATE_SOCKET,
     CLIENT_STATE_WAIT_CREATE_SOCKET_RESPONSE,
+    CLIENT_STATE_WAIT_OPTIONS,
     CLIENT_STATE_ENABLE_SSL,
     CLIENT_STATE_WAIT_ENABLE_SSL_RESPONSE,
     CLIENT_STATE_MANAGE_SSL_PROFILE,
@@ -37,6 +52,15 @@ enum {
     CLIENT_STATE_WAIT_CLOSE_SOCKET
 };
 
+// Socket options, in the order they are sent
+enum {
+    CLIENT_OPTION_KEEPALIVE = 0x01,
+    CLIENT_OPTION_KEEPIDLE = 0x02,
+    CLIENT_OPTION_NODELAY = 0x04,
+    CLIENT_OPTION_LINGER = 0x08,
+    CLIENT_OPTION_TOS = 0x10
+};
+
 NBClient::NBClient(Modem &modem, bool synch) :
         NBClient(modem, -1, synch) {
 }
@@ -51,13 +75,130 @@ NBClient::NBClient(Modem &modem, int socket, bool synch) :
         _host(nullptr),
         _port(0),
         _ssl(false),
+        _fastClose(false),
+        _connectState(CLIENT_STATE_IDLE),
+        _connectResult(NB_CONNECT_OK),
+        _connectAborted(false),
+        _connectCallback(nullptr),
+        _connectContext(nullptr),
+        _connectTimes({0, 0, 0}),
+        _phaseMillis(0),
         _writeSync(true),
-        _nbSocketBuffer(NBSocketBuffer(_modem)) {
-    _modem.addUrcHandler(this);
+        _txLength(0),
+        _txMillis(0),
+        _flushTimeout(NB_CLIENT_FLUSH_TIMEOUT),
+        _writeCalls(0),
+        _writeCommands(0),
+        _writeInFlight(0),
+        _sendWindow(NB_CLIENT_SEND_WINDOW),
+        _unacked(0),
+        _unackedMillis(0),
+        _unackedQueued(false),
+        _options(0),
+        _optionsPending(0),
+        _optionInFlight(false),
+        _keepAlive(false),
+        _keepIdle(0),
+        _noDelay(false),
+        _linger(false),
+        _lingerTime(0),
+        _tos(0) {
+    NBSocketTable &sockets = _modem.sockets();
+
+    // a socket the table did not follow may hold data announced before this client existed
+    if (_socket >= 0 && !sockets.closed(_socket) && sockets.pending(_socket) == 0 && sockets.buffered(_socket) == 0) {
+        sockets.announce(_socket, NB_SOCKET_PENDING_UNKNOWN);
+    }
+}
+
+NBClient &NBClient::operator=(const NBClient &other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    // queued connect, option and window commands must not call back into the adopted state
+    if (_connectState != CLIENT_STATE_IDLE || _optionInFlight || _unackedQueued) {
+        _modem.cancel(this);
+    }
+
+    // the modem reference stays, only the state of the socket moves over
+    _synch = other._synch;
+    _socket = other._socket;
+    _connected = other._connected;
+    _state = CLIENT_STATE_IDLE;
+    _ip = other._ip;
+    _host = other._host;
+    _port = other._port;
+    _ssl = other._ssl;
+    _fastClose = other._fastClose;
+
+    // a connect in progress keeps calling back into the other client
+    _connectState = CLIENT_STATE_IDLE;
+    _connectResult = other._connectResult;
+    _connectAborted = false;
+    _connectCallback = nullptr;
+    _connectContext = nullptr;
+    _connectTimes = other._connectTimes;
+    _phaseMillis = other._phaseMillis;
+
+    _writeSync = other._writeSync;
+    memcpy(_txBuffer, other._txBuffer, other._txLength);
+    _txLength = other._txLength;
+    _txMillis = other._txMillis;
+    _flushTimeout = other._flushTimeout;
+    _writeCalls = other._writeCalls;
+    _writeCommands = other._writeCommands;
+    _writeInFlight = other._writeInFlight;
+    _sendWindow = other._sendWindow;
+    _unacked = other._unacked;
+    _unackedMillis = other._unackedMillis;
+    _unackedQueued = false;
+
+    // an option in flight completes for the other client
+    _options = other._options;
+    _optionsPending = other._optionsPending;
+    _optionInFlight = false;
+    _keepAlive = other._keepAlive;
+    _keepIdle = other._keepIdle;
+    _noDelay = other._noDelay;
+    _linger = other._linger;
+    _lingerTime = other._lingerTime;
+    _tos = other._tos;
+
+    return *this;
 }
 
 NBClient::~NBClient() {
-    _modem.removeUrcHandler(this);
+    // an AT+USOCR already sent has to answer, or its socket stays open on the modem
+    while (_connectState == CLIENT_STATE_WAIT_CREATE_SOCKET_RESPONSE && _modem.executing(this)) {
+        _modem.waitForData(NB_CLIENT_WAIT_TIMEOUT);
+        _modem.poll();
+    }
+
+    // queued connect, option and window commands must not call back into a client that is gone
+    if (_connectState != CLIENT_STATE_IDLE || _optionInFlight || _unackedQueued) {
+        bool closeSent = _connectState == CLIENT_STATE_WAIT_CLOSE_SOCKET && _modem.executing(this);
+
+        _modem.cancel(this);
+
+        if (_connectState != CLIENT_STATE_IDLE && _socket != -1) {
+            if (closeSent) {
+                _modem.sockets().close(_socket);
+            } else {
+                _modem.sockets().requestClose(_socket);
+            }
+        }
+    }
+}
+
+void NBClient::waitReady() {
+    while (ready() == 0) {
+        // only wait for the modem when a command is executing, or a queued close or option holds up the next, not between states
+        if (_modem.lastResult() == MODEM_RESULT_PENDING || _state == CLIENT_STATE_CREATE_SOCKET ||
+            (_state == CLIENT_STATE_WAIT_OPTIONS && _optionInFlight)) {
+            _modem.waitForData(NB_CLIENT_WAIT_TIMEOUT);
+        }
+    }
 }
 
 int NBClient::ready() {
@@ -67,6 +208,11 @@ int NBClient::ready() {
         return 0;
     }
 
+    // result of the last chunk of an async write
+    if (_writeInFlight) {
+        writeCompleted(ready);
+    }
+
     switch (_state) {
         case CLIENT_STATE_IDLE:
         default: {
@@ -74,8 +220,17 @@ int NBClient::ready() {
         }
 
         case CLIENT_STATE_CREATE_SOCKET: {
+            // an async client polls until create() would not wait
+            if (!_synch && _modem.sockets().closeQueued()) {
+                ready = 0;
+                break;
+            }
+
+            _connectTimes = {0, 0, 0};
+            _phaseMillis = millis();
+
             _modem.setResponseDataStorage(&_response);
-            _modem.send("AT+USOCR=6");
+            _modem.sockets().create(6);
 
             _state = CLIENT_STATE_WAIT_CREATE_SOCKET_RESPONSE;
             ready = 0;
@@ -87,18 +242,28 @@ int NBClient::ready() {
                 _state = CLIENT_STATE_IDLE;
             } else {
                 _socket = _response.charAt(_response.length() - 1) - '0';
+                _unacked = 0;
+                _modem.sockets().open(_socket);
+                _connectTimes.create = endPhase();
+                startOptions();
 
-                if (_ssl) {
-                    _state = CLIENT_STATE_ENABLE_SSL;
-                } else {
-                    _state = CLIENT_STATE_CONNECT;
-                }
-
+                _state = CLIENT_STATE_WAIT_OPTIONS;
                 ready = 0;
             }
             break;
         }
 
+        case CLIENT_STATE_WAIT_OPTIONS: {
+            // the queued options apply before the connect, one left behind by a full queue after it
+            applyOptions();
+            if (!_optionInFlight) {
+                _state = _ssl ? CLIENT_STATE_ENABLE_SSL : CLIENT_STATE_CONNECT;
+            }
+
+            ready = 0;
+            break;
+        }
+
         case CLIENT_STATE_ENABLE_SSL: {
             _modem.sendf("AT+USOSEC=%d,1,0", _socket);
 
@@ -129,6 +294,7 @@ int NBClient::ready() {
             if (ready > 1) {
                 _state = CLIENT_STATE_CLOSE_SOCKET;
             } else {
+                _connectTimes.secure = endPhase();
                 _state = CLIENT_STATE_CONNECT;
             }
             ready = 0;
@@ -153,6 +319,7 @@ int NBClient::ready() {
 
                 ready = 0;
             } else {
+                _connectTimes.connect = endPhase();
                 _connected = true;
                 _state = CLIENT_STATE_IDLE;
             }
@@ -170,6 +337,7 @@ int NBClient::ready() {
 
         case CLIENT_STATE_WAIT_CLOSE_SOCKET: {
             _state = CLIENT_STATE_IDLE;
+            _modem.sockets().close(_socket);
             _socket = -1;
             break;
         }
@@ -219,8 +387,14 @@ int NBClient::connect() {
         stop();
     }
 
+    // a stopped async connect closes its socket first
+    while (_connectState != CLIENT_STATE_IDLE) {
+        _modem.poll();
+        _modem.waitForData(NB_CLIENT_WAIT_TIMEOUT);
+    }
+
     if (_synch) {
-        while (ready() == 0);
+        waitReady();
     } else if (ready() == 0) {
         return 0;
     }
@@ -228,9 +402,7 @@ int NBClient::connect() {
     _state = CLIENT_STATE_CREATE_SOCKET;
 
     if (_synch) {
-        while (ready() == 0) {
-            delay(100);
-        }
+        waitReady();
 
         if (_socket == -1) {
             return 0;
@@ -240,6 +412,236 @@ int NBClient::connect() {
     return 1;
 }
 
+bool NBClient::connectAsync(IPAddress ip, uint16_t port, NBConnectCallback callback, void *context) {
+    if (_connectState != CLIENT_STATE_IDLE) {
+        return false;
+    }
+
+    _ip = ip;
+    _host = nullptr;
+    _port = port;
+    _ssl = false;
+
+    return connectAsync(callback, context);
+}
+
+bool NBClient::connectSSLAsync(IPAddress ip, uint16_t port, NBConnectCallback callback, void *context) {
+    if (_connectState != CLIENT_STATE_IDLE) {
+        return false;
+    }
+
+    _ip = ip;
+    _host = nullptr;
+    _port = port;
+    _ssl = true;
+
+    return connectAsync(callback, context);
+}
+
+bool NBClient::connectAsync(const char *host, uint16_t port, NBConnectCallback callback, void *context) {
+    if (_connectState != CLIENT_STATE_IDLE) {
+        return false;
+    }
+
+    _ip = (uint32_t) 0;
+    _host = host;
+    _port = port;
+    _ssl = false;
+
+    return connectAsync(callback, context);
+}
+
+bool NBClient::connectSSLAsync(const char *host, uint16_t port, NBConnectCallback callback, void *context) {
+    if (_connectState != CLIENT_STATE_IDLE) {
+        return false;
+    }
+
+    _ip = (uint32_t) 0;
+    _host = host;
+    _port = port;
+    _ssl = true;
+
+    return connectAsync(callback, context);
+}
+
+bool NBClient::connectAsync(NBConnectCallback callback, void *context) {
+    char command[MODEM_COMMAND_QUEUE_COMMAND_LENGTH + 1];
+
+    // fail now rather than after the socket was created
+    if (!connectCommand(command, sizeof(command))) {
+        return false;
+    }
+
+    if (_socket != -1) {
+        stop();
+    }
+
+    if (!_modem.enqueue("AT+USOCR=6", 10000, connectStep, this)) {
+        return false;
+    }
+
+    _connectState = CLIENT_STATE_WAIT_CREATE_SOCKET_RESPONSE;
+    _connectResult = NB_CONNECT_OK;
+    _connectAborted = false;
+    _connectCallback = callback;
+    _connectContext = context;
+    _connectTimes = {0, 0, 0};
+    _phaseMillis = millis();
+
+    return true;
+}
+
+bool NBClient::connectCommand(char *command, size_t size) {
+    int length;
+
+    if (_host != nullptr) {
+        length = snprintf(command, size, "AT+USOCO=%d,\"%s\",%d", _socket < 0 ? 0 : _socket, _host, _port);
+    } else {
+        length = snprintf(command, size, "AT+USOCO=%d,\"%d.%d.%d.%d\",%d", _socket < 0 ? 0 : _socket,
+                          _ip[0], _ip[1], _ip[2], _ip[3], _port);
+    }
+
+    return length > 0 && (size_t) length < size;
+}
+
+unsigned long NBClient::endPhase() {
+    unsigned long now = millis();
+    unsigned long elapsed = now - _phaseMillis;
+
+    _phaseMillis = now;
+
+    return elapsed;
+}
+
+void NBClient::connectStep(int result, const String &response, void *context) {
+    ((NBClient *) context)->connectStep(result, response);
+}
+
+void NBClient::connectStep(int result, const String &response) {
+    int failure = result < 0 ? NB_CONNECT_TIMEOUT : NB_CONNECT_OK;
+
+    switch (_connectState) {
+        case CLIENT_STATE_WAIT_CREATE_SOCKET_RESPONSE: {
+            if (result != MODEM_RESULT_OK || !response.startsWith("+USOCR: ")) {
+                connectDone(failure != NB_CONNECT_OK ? failure : NB_CONNECT_CREATE_FAILED);
+                break;
+            }
+
+            _socket = response.charAt(response.length() - 1) - '0';
+            _unacked = 0;
+            _modem.sockets().open(_socket);
+            _connectTimes.create = endPhase();
+
+            if (_connectAborted) {
+                connectFailed(NB_CONNECT_ABORTED);
+                break;
+            }
+
+            // the options apply before the connect, as in the synchronous path
+            _connectState = CLIENT_STATE_WAIT_OPTIONS;
+            startOptions();
+            if (!_optionInFlight) {
+                connectSocket();
+            }
+            break;
+        }
+
+        case CLIENT_STATE_WAIT_ENABLE_SSL_RESPONSE: {
+            if (result != MODEM_RESULT_OK || _connectAborted) {
+                connectFailed(_connectAborted ? NB_CONNECT_ABORTED : failure != NB_CONNECT_OK ? failure : NB_CONNECT_SECURE_FAILED);
+            } else {
+                connectNext("AT+USECPRF=0,0,0", 10000, CLIENT_STATE_WAIT_MANAGE_SSL_PROFILE_RESPONSE);
+            }
+            break;
+        }
+
+        case CLIENT_STATE_WAIT_MANAGE_SSL_PROFILE_RESPONSE: {
+            if (result != MODEM_RESULT_OK || _connectAborted) {
+                connectFailed(_connectAborted ? NB_CONNECT_ABORTED : failure != NB_CONNECT_OK ? failure : NB_CONNECT_SECURE_FAILED);
+            } else {
+                char command[MODEM_COMMAND_QUEUE_COMMAND_LENGTH + 1];
+
+                _connectTimes.secure = endPhase();
+                connectCommand(command, sizeof(command));
+                connectNext(command, NB_CLIENT_CONNECT_TIMEOUT, CLIENT_STATE_WAIT_CONNECT_RESPONSE);
+            }
+            break;
+        }
+
+        case CLIENT_STATE_WAIT_CONNECT_RESPONSE: {
+            if (result != MODEM_RESULT_OK || _connectAborted) {
+                connectFailed(_connectAborted ? NB_CONNECT_ABORTED : failure != NB_CONNECT_OK ? failure : NB_CONNECT_FAILED);
+            } else {
+                _connectTimes.connect = endPhase();
+                _connected = true;
+                connectDone(NB_CONNECT_OK);
+            }
+            break;
+        }
+
+        case CLIENT_STATE_WAIT_CLOSE_SOCKET: {
+            _modem.sockets().close(_socket);
+            _socket = -1;
+            connectDone(_connectResult);
+            break;
+        }
+
+        default: {
+            break;
+        }
+    }
+}
+
+void NBClient::connectSocket() {
+    if (_connectAborted) {
+        connectFailed(NB_CONNECT_ABORTED);
+    } else if (_ssl) {
+        char command[24];
+
+        snprintf(command, sizeof(command), "AT+USOSEC=%d,1,0", _socket);
+        connectNext(command, 10000, CLIENT_STATE_WAIT_ENABLE_SSL_RESPONSE);
+    } else {
+        char command[MODEM_COMMAND_QUEUE_COMMAND_LENGTH + 1];
+
+        connectCommand(command, sizeof(command));
+        connectNext(command, NB_CLIENT_CONNECT_TIMEOUT, CLIENT_STATE_WAIT_CONNECT_RESPONSE);
+    }
+}
+
+void NBClient::connectNext(const char *command, unsigned long timeout, int state) {
+    _connectState = state;
+
+    if (!_modem.enqueue(command, timeout, connectStep, this)) {
+        connectFailed(NB_CONNECT_BUSY);
+    }
+}
+
+void NBClient::connectFailed(int result) {
+    char command[16];
+
+    // close the socket the connect created before reporting
+    _connectResult = result;
+    _connectState = CLIENT_STATE_WAIT_CLOSE_SOCKET;
+
+    snprintf(command, sizeof(command), "AT+USOCL=%d", _socket);
+    if (!_modem.enqueue(command, 10000, connectStep, this)) {
+        _modem.sockets().close(_socket);
+        _socket = -1;
+        connectDone(result);
+    }
+}
+
+void NBClient::connectDone(int result) {
+    NBConnectCallback callback = _connectCallback;
+
+    _connectState = CLIENT_STATE_IDLE;
+    _connectCallback = nullptr;
+
+    if (callback != nullptr) {
+        callback(result, _connectContext);
+    }
+}
+
 void NBClient::beginWrite(bool sync) {
     _writeSync = sync;
 }
@@ -252,83 +654,289 @@ size_t NBClient::write(const uint8_t *buf) {
     return write(buf, strlen((const char *) buf));
 }
 
-size_t NBClient::write(const uint8_t *buf, size_t size) {
+size_t NBClient::sendData(const uint8_t *buf, size_t size) {
+    NBSegment segment = {buf, size};
+
+    return sendData(&segment, 1);
+}
+
+size_t NBClient::sendData(const NBSegment *segments, size_t count) {
+    size_t size = NBHex::length(segments, count);
+
     if (_writeSync) {
-        while (ready() == 0);
+        waitReady();
     } else if (ready() == 0) {
         return 0;
     }
 
-    if (_socket == -1) {
+    if (_socket == -1 || size == 0) {
         return 0;
     }
 
     size_t written = 0;
-    String command;
-
-    command.reserve(19 + (size > 256 ? 256 : size) * 2);
 
     while (size) {
-        size_t chunkSize = size;
+        size_t chunkSize = size < NB_CLIENT_WRITE_CHUNK_SIZE ? size : NB_CLIENT_WRITE_CHUNK_SIZE;
+        char command[24];
+
+        if (!waitForWindow(chunkSize)) {
+            break;
+        }
+
+        // the chunk is hex encoded straight to the modem, from the segments
+        snprintf(command, sizeof(command), "AT+USOWR=%d,%u,\"", _socket, (unsigned int) chunkSize);
+        _modem.setResponseDataStorage(&_response);
+        _modem.sendHex(command, segments, count, written, chunkSize, "\"");
+        _writeCommands++;
+        _writeInFlight = chunkSize;
+
+        written += chunkSize;
+        size -= chunkSize;
+
+        // an async write leaves its chunk to ready() and takes no more, the caller writes the rest later
+        if (!_writeSync) {
+            break;
+        }
+
+        size_t accepted = writeCompleted(_modem.waitForResponse(10000, &_response));
+        if (accepted < chunkSize) {
+            written -= chunkSize - accepted;
+            break;
+        }
+    }
+
+    return written;
+}
+
+size_t NBClient::writeCompleted(int result) {
+    size_t requested = _writeInFlight;
+
+    _writeInFlight = 0;
+
+    if (result != MODEM_RESULT_OK) {
+        setWriteError();
+
+        if (result == MODEM_RESULT_CME_ERROR && _modem.lastErrorCode() == MODEM_CME_OPERATION_NOT_ALLOWED) {
+            // nothing collected can be sent anymore
+            _txLength = 0;
+            stop();
+        }
+
+        return 0;
+    }
+
+    // +USOWR: <socket>,<length>, the modem may take less than it was sent
+    size_t accepted = requested;
+    int comma = _response.lastIndexOf(',');
+    if (_response.startsWith("+USOWR: ") && comma > 0) {
+        accepted = _response.substring(comma + 1).toInt();
 
-        if (chunkSize > 256) {
-            chunkSize = 256;
+        if (accepted < requested) {
+            setWriteError();
+        } else {
+            accepted = requested;
         }
+    }
 
-        command.reserve(19 + chunkSize * 2);
+    _unacked += accepted;
 
-        command = "AT+USOWR=";
-        command += _socket;
-        command += ",";
-        command += chunkSize;
-        command += ",\"";
+    return accepted;
+}
 
-        for (size_t i = 0; i < chunkSize; i++) {
-            byte b = buf[i + written];
+bool NBClient::updateUnacked() {
+    _modem.sendf("AT+USOCTL=%d,11", _socket);
+    if (_modem.waitForResponse(10000, &_response) != MODEM_RESULT_OK || !_response.startsWith("+USOCTL: ")) {
+        return false;
+    }
+
+    // +USOCTL: <socket>,11,<bytes>
+    _unacked = _response.substring(_response.lastIndexOf(',') + 1).toInt();
+    _unackedMillis = millis();
 
-            byte n1 = (b >> 4) & 0x0f;
-            byte n2 = (b & 0x0f);
+    return true;
+}
 
-            command += (char) (n1 > 9 ? 'A' + n1 - 10 : '0' + n1);
-            command += (char) (n2 > 9 ? 'A' + n2 - 10 : '0' + n2);
+void NBClient::refreshUnacked() {
+    char command[24];
+
+    if (_unackedQueued) {
+        return;
+    }
+
+    snprintf(command, sizeof(command), "AT+USOCTL=%d,11", _socket);
+    if (_modem.enqueue(command, 10000, unackedCompleted, this)) {
+        _unackedQueued = true;
+    }
+}
+
+void NBClient::unackedCompleted(int result, const String &response, void *context) {
+    NBClient *client = (NBClient *) context;
+
+    client->_unackedQueued = false;
+
+    // +USOCTL: <socket>,11,<bytes>, of a socket the client may have closed meanwhile
+    if (result != MODEM_RESULT_OK || !response.startsWith("+USOCTL: ") ||
+        response.substring(9).toInt() != client->_socket) {
+        return;
+    }
+
+    client->_unacked = response.substring(response.lastIndexOf(',') + 1).toInt();
+    client->_unackedMillis = millis();
+}
+
+bool NBClient::waitForWindow(size_t size) {
+    if (_unacked + size <= _sendWindow) {
+        return true;
+    }
+
+    // an async write does not wait, the window is refreshed in the background
+    if (!_writeSync) {
+        refreshUnacked();
+
+        return false;
+    }
+
+    for (unsigned long start = millis();;) {
+        if (!updateUnacked()) {
+            return false;
+        }
+
+        // an idle modem always takes a chunk, whatever the window
+        if (_unacked == 0 || _unacked + size <= _sendWindow) {
+            return true;
         }
 
-        command += "\"";
+        if ((millis() - start) >= NB_CLIENT_SEND_WINDOW_TIMEOUT) {
+            return false;
+        }
+
+        _modem.poll();
+        _modem.waitForData(NB_CLIENT_SEND_WINDOW_POLL_INTERVAL);
+    }
+}
+
+int NBClient::availableForWrite() {
+    if (_socket == -1) {
+        return 0;
+    }
+
+    // the modem is asked at most once per poll interval, async clients get the cached window
+    if (_unacked && (millis() - _unackedMillis) >= NB_CLIENT_SEND_WINDOW_POLL_INTERVAL) {
+        if (!_synch) {
+            refreshUnacked();
+        } else {
+            waitReady();
 
-        _modem.send(command);
-        if (_writeSync) {
-            String response;
-            int status = _modem.waitForResponse(10000, &response);
-            if (status != 1) {
-                if (status == 4 && response.indexOf("Operation not allowed") != -1) {
-                    stop();
-                    break;
-                } else {
-                    break;
-                }
+            if (_socket != -1) {
+                updateUnacked();
             }
         }
+    }
 
-        written += chunkSize;
-        size -= chunkSize;
+    size_t queued = _unacked + _txLength;
+
+    return queued < _sendWindow ? (int) (_sendWindow - queued) : 0;
+}
+
+size_t NBClient::write(const uint8_t *buf, size_t size) {
+    if (_socket == -1) {
+        return 0;
     }
 
-    return written;
+    _writeCalls++;
+    flushIfIdle();
+
+    if (_txLength + size > NB_CLIENT_TX_BUFFER_SIZE && !flushTx()) {
+        return 0;
+    }
+
+    // too large to gain anything from collecting
+    if (size >= NB_CLIENT_TX_BUFFER_SIZE) {
+        return sendData(buf, size);
+    }
+
+    memcpy(_txBuffer + _txLength, buf, size);
+    _txLength += size;
+    _txMillis = millis();
+
+    return size;
+}
+
+size_t NBClient::write(const NBSegment *segments, size_t count) {
+    if (_socket == -1) {
+        return 0;
+    }
+
+    size_t size = NBHex::length(segments, count);
+
+    _writeCalls++;
+    flushIfIdle();
+
+    if (_txLength + size > NB_CLIENT_TX_BUFFER_SIZE && !flushTx()) {
+        return 0;
+    }
+
+    // the segments go out together, hex encoded straight from their buffers
+    if (size >= NB_CLIENT_TX_BUFFER_SIZE) {
+        return sendData(segments, count);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        memcpy(_txBuffer + _txLength, segments[i].data, segments[i].length);
+        _txLength += segments[i].length;
+    }
+    _txMillis = millis();
+
+    return size;
+}
+
+bool NBClient::flushTx() {
+    if (_txLength == 0) {
+        return true;
+    }
+
+    size_t sent = sendData(_txBuffer, _txLength);
+
+    // in async mode the modem may still be busy, keep what was not sent
+    if (sent < _txLength) {
+        memmove(_txBuffer, _txBuffer + sent, _txLength - sent);
+        _txLength -= sent;
+
+        return false;
+    }
+
+    _txLength = 0;
+
+    return true;
+}
+
+void NBClient::flushIfIdle() {
+    if (_txLength && _flushTimeout && (millis() - _txMillis) >= _flushTimeout) {
+        flushTx();
+    }
 }
 
 void NBClient::endWrite(bool /*sync*/) {
     _writeSync = true;
+    flushTx();
 }
 
 uint8_t NBClient::connected() {
     _modem.poll();
 
-    if (_socket == -1) {
+    if (_socket == -1 || _connectState != CLIENT_STATE_IDLE) {
         return 0;
     }
 
-    // call available to update socket state
-    if (_nbSocketBuffer.available(_socket) < 0 || (_ssl && !_connected)) {
+    flushIfIdle();
+    // options that found the command queue full
+    applyOptions();
+
+    // the socket table follows +UUSOCL and +UUSORD, a closed socket stays connected until its data was read
+    NBSocketTable &sockets = _modem.sockets();
+    bool drained = sockets.buffered(_socket) == 0 && sockets.pending(_socket) <= 0 && !sockets.reading(_socket);
+
+    if ((sockets.closed(_socket) && drained) || (_ssl && !_connected)) {
         stop();
 
         return 0;
@@ -356,7 +964,63 @@ int NBClient::read(uint8_t *buf, size_t size) {
         return 0;
     }
 
-    return _nbSocketBuffer.read(_socket, buf, size);
+    return _modem.sockets().read(_socket, buf, size);
+}
+
+size_t NBClient::peekSpan(const uint8_t **data) {
+    if (available() <= 0) {
+        return 0;
+    }
+
+    return _modem.sockets().span(_socket, data);
+}
+
+void NBClient::consume(size_t length) {
+    if (_socket != -1) {
+        _modem.sockets().consume(_socket, length);
+    }
+}
+
+size_t NBClient::readBytesUntil(char terminator, char *buffer, size_t length) {
+    size_t count = 0;
+    unsigned long start = millis();
+
+    while (count < length) {
+        const uint8_t *data;
+        size_t span = peekSpan(&data);
+
+        if (span == 0) {
+            unsigned long elapsed = millis() - start;
+
+            if (_socket == -1 || elapsed >= _timeout) {
+                break;
+            }
+
+            _modem.poll();
+            _modem.waitForData(_timeout - elapsed);
+            continue;
+        }
+
+        if (span > length - count) {
+            span = length - count;
+        }
+
+        const uint8_t *end = (const uint8_t *) memchr(data, terminator, span);
+        size_t n = end != NULL ? (size_t) (end - data) : span;
+
+        memcpy(buffer + count, data, n);
+        count += n;
+
+        if (end != NULL) {
+            consume(n + 1);
+            break;
+        }
+
+        consume(n);
+        start = millis();
+    }
+
+    return count;
 }
 
 int NBClient::read() {
@@ -371,7 +1035,7 @@ int NBClient::read() {
 
 int NBClient::available() {
     if (_synch) {
-        while (ready() == 0);
+        waitReady();
     } else if (ready() == 0) {
         return 0;
     }
@@ -380,7 +1044,10 @@ int NBClient::available() {
         return 0;
     }
 
-    int avail = _nbSocketBuffer.available(_socket);
+    // a response can only follow the request, so what was collected goes out first
+    flushTx();
+
+    int avail = _modem.sockets().available(_socket);
 
     if (avail < 0) {
         stop();
@@ -393,37 +1060,213 @@ int NBClient::available() {
 
 int NBClient::peek() {
     if (available() > 0) {
-        return _nbSocketBuffer.peek(_socket);
+        return _modem.sockets().peek(_socket);
     }
 
     return -1;
 }
 
 void NBClient::flush() {
+    if (_socket != -1) {
+        flushTx();
+    }
 }
 
 void NBClient::stop() {
     _state = CLIENT_STATE_IDLE;
+
+    // an async connect winds down from its queued commands and closes its socket itself
+    if (_connectState != CLIENT_STATE_IDLE) {
+        _connectAborted = true;
+        return;
+    }
+
     if (_socket < 0) {
         return;
     }
 
-    _modem.sendf("AT+USOCL=%d", _socket);
-    _modem.waitForResponse(10000);
+    // a failed send closes the socket already
+    flushTx();
+    if (_writeInFlight) {
+        waitReady();
+    }
+    if (_socket < 0) {
+        return;
+    }
 
-    _nbSocketBuffer.close(_socket);
+    // the modem closes the socket in the background
+    _modem.sockets().requestClose(_socket, _fastClose);
 
     _socket = -1;
     _connected = false;
+    _txLength = 0;
+    _unacked = 0;
 }
 
-void NBClient::handleUrc(const String &urc) {
-    if (urc.startsWith("+UUSORD: ")) {
-        int socket = urc.charAt(9) - '0';
-        if (socket == _socket) {
-            if (urc.endsWith(",4294967295")) {
-                _connected = false;
-            }
+void NBClient::setKeepAlive(bool enable, unsigned long idleMillis) {
+    _keepAlive = enable;
+    setOption(CLIENT_OPTION_KEEPALIVE);
+
+    if (idleMillis > 0) {
+        _keepIdle = idleMillis;
+        setOption(CLIENT_OPTION_KEEPIDLE);
+    }
+}
+
+void NBClient::setNoDelay(bool noDelay) {
+    _noDelay = noDelay;
+    setOption(CLIENT_OPTION_NODELAY);
+}
+
+void NBClient::setLinger(bool enable, unsigned long lingerMillis) {
+    _linger = enable;
+    _lingerTime = lingerMillis;
+    setOption(CLIENT_OPTION_LINGER);
+}
+
+void NBClient::setTos(uint8_t tos) {
+    _tos = tos;
+    setOption(CLIENT_OPTION_TOS);
+}
+
+int NBClient::getKeepAlive(unsigned long *idleMillis) {
+    long value;
+    long idle;
+
+    if (!queryOption(65535, 8, value, NULL)) {
+        return -1;
+    }
+
+    if (idleMillis != NULL) {
+        if (!queryOption(6, 2, idle, NULL)) {
+            return -1;
         }
+
+        *idleMillis = idle;
+    }
+
+    return value != 0;
+}
+
+int NBClient::getNoDelay() {
+    long value;
+
+    return queryOption(6, 1, value, NULL) ? value != 0 : -1;
+}
+
+int NBClient::getLinger(unsigned long *lingerMillis) {
+    long value;
+    long time = 0;
+
+    if (!queryOption(65535, 128, value, &time)) {
+        return -1;
     }
-}
\ No newline at end of file
+
+    if (lingerMillis != NULL) {
+        *lingerMillis = time;
+    }
+
+    return value != 0;
+}
+
+int NBClient::getTos() {
+    long value;
+
+    return queryOption(0, 1, value, NULL) ? (int) value : -1;
+}
+
+void NBClient::setOption(uint8_t option) {
+    _options |= option;
+    _optionsPending |= option;
+
+    applyOptions();
+}
+
+void NBClient::startOptions() {
+    // a new socket starts with the modem defaults
+    _optionsPending = _options;
+
+    applyOptions();
+}
+
+void NBClient::applyOptions() {
+    // one option at a time, each completion queues the next
+    if (_optionInFlight || _optionsPending == 0 || _socket < 0) {
+        return;
+    }
+
+    uint8_t option = _optionsPending & -_optionsPending;
+    char command[48];
+
+    switch (option) {
+        case CLIENT_OPTION_KEEPALIVE:
+            snprintf(command, sizeof(command), "AT+USOSO=%d,65535,8,%d", _socket, _keepAlive);
+            break;
+
+        case CLIENT_OPTION_KEEPIDLE:
+            snprintf(command, sizeof(command), "AT+USOSO=%d,6,2,%lu", _socket, _keepIdle);
+            break;
+
+        case CLIENT_OPTION_NODELAY:
+            snprintf(command, sizeof(command), "AT+USOSO=%d,6,1,%d", _socket, _noDelay);
+            break;
+
+        case CLIENT_OPTION_LINGER:
+            snprintf(command, sizeof(command), "AT+USOSO=%d,65535,128,%d,%lu", _socket, _linger, _lingerTime);
+            break;
+
+        case CLIENT_OPTION_TOS:
+        default:
+            snprintf(command, sizeof(command), "AT+USOSO=%d,0,1,%d", _socket, _tos);
+            break;
+    }
+
+    // with the queue full the option is sent from a later call
+    if (_modem.enqueue(command, NB_CLIENT_OPTION_TIMEOUT, optionCompleted, this)) {
+        _optionsPending &= ~option;
+        _optionInFlight = true;
+    }
+}
+
+void NBClient::optionCompleted(int /*result*/, const String & /*response*/, void *context) {
+    NBClient *client = (NBClient *) context;
+
+    // a refused option keeps the modem default, the getters show it
+    client->_optionInFlight = false;
+    client->applyOptions();
+
+    // an option the full queue held back goes out after the connect
+    if (client->_connectState == CLIENT_STATE_WAIT_OPTIONS && !client->_optionInFlight) {
+        client->connectSocket();
+    }
+}
+
+bool NBClient::queryOption(int level, int name, long &value, long *value2) {
+    String response;
+
+    // the options still queued for the socket go out first
+    while (_socket >= 0 && (_optionsPending != 0 || _optionInFlight)) {
+        applyOptions();
+        _modem.poll();
+        _modem.waitForData(NB_CLIENT_WAIT_TIMEOUT);
+    }
+
+    if (_socket < 0) {
+        return false;
+    }
+
+    _modem.sendf("AT+USOGO=%d,%d,%d", _socket, level, name);
+    if (_modem.waitForResponse(NB_CLIENT_OPTION_TIMEOUT, &response) != 1 || !response.startsWith("+USOGO: ")) {
+        return false;
+    }
+
+    const char *values = response.c_str() + 8;
+    const char *comma = strchr(values, ',');
+
+    value = atol(values);
+    if (value2 != NULL) {
+        *value2 = comma != NULL ? atol(comma + 1) : 0;
+    }
+
+    return true;
+}
@@ -21,12 +21,60 @@
 #define _NB_CLIENT_H_INCLUDED
 
 #include "Modem.h"
-
-#include "utility/NBSocketBuffer.h"
+#include "utility/NBHex.h"
 
 #include <Client.h>
 
-class NBClient : public Client, public ModemUrcHandler {
+// Small writes are collected up to this many bytes before an AT+USOWR is sent
+#ifndef NB_CLIENT_TX_BUFFER_SIZE
+#define NB_CLIENT_TX_BUFFER_SIZE 128
+#endif
+
+// Payload bytes per AT+USOWR command, 512 is the most the firmware takes as hex
+#ifndef NB_CLIENT_WRITE_CHUNK_SIZE
+#define NB_CLIENT_WRITE_CHUNK_SIZE 512
+#endif
+
+// Most bytes the modem is left to send and get acknowledged before writes wait, see setSendWindow
+#ifndef NB_CLIENT_SEND_WINDOW
+#define NB_CLIENT_SEND_WINDOW 4096
+#endif
+
+// Idle time after which collected writes are sent, in milliseconds
+#ifndef NB_CLIENT_FLUSH_TIMEOUT
+#define NB_CLIENT_FLUSH_TIMEOUT 50
+#endif
+
+// Time an AT+USOCO may take, in milliseconds
+#ifndef NB_CLIENT_CONNECT_TIMEOUT
+#define NB_CLIENT_CONNECT_TIMEOUT 120000
+#endif
+
+// How a connect started with connectAsync() ended
+enum NBConnectResult {
+    NB_CONNECT_OK,
+    NB_CONNECT_BUSY,            // command queue full
+    NB_CONNECT_CREATE_FAILED,   // AT+USOCR failed, e.g. no socket left
+    NB_CONNECT_SECURE_FAILED,   // AT+USOSEC or AT+USECPRF failed
+    NB_CONNECT_FAILED,          // AT+USOCO failed, e.g. host not found or refused
+    NB_CONNECT_TIMEOUT,         // a command got no result in time
+    NB_CONNECT_ABORTED          // stop() was called
+};
+
+// Time the phases of the last connect took, in milliseconds
+struct NBConnectTimes {
+    unsigned long create;   // AT+USOCR
+    unsigned long secure;   // AT+USOSEC and AT+USECPRF, 0 without SSL
+    unsigned long connect;  // AT+USOCO
+};
+
+/** Called when a connect started with connectAsync() ends
+    @param result   NBConnectResult
+    @param context  Context passed to connectAsync
+ */
+typedef void (*NBConnectCallback)(int result, void *context);
+
+class NBClient : public Client {
 
 public:
 
@@ -35,7 +83,9 @@ public:
      */
     NBClient(Modem &modem, bool synch = true);
 
-    /** Constructor
+    /** Constructor, adopts a socket the modem already created
+        The socket keeps the state the socket table followed, e.g. a close
+        the peer reported before the client existed.
         @param socket   Socket
         @param synch    Sync mode
      */
@@ -43,6 +93,14 @@ public:
 
     virtual ~NBClient();
 
+    /** Take over the socket of another client, e.g. client = server.available()
+        Both clients must belong to the same modem. Commands this client still
+        had queued are dropped, it does not close its previous socket.
+        @param other    Client to copy the socket state from
+        @return this client
+     */
+    NBClient &operator=(const NBClient &other);
+
     /** Get last command status
         @return returns 0 if last command is still executing, 1 success, >1 error
     */
@@ -66,6 +124,48 @@ public:
 
     int connectSSL(const char *host, uint16_t port);
 
+    /** Start connecting to a server by IP address, without waiting
+        The commands run from the command queue, the connect advances whenever
+        Modem::poll() runs and ends with a call of the callback.
+        @param ip       IP address
+        @param port     Port
+        @param callback Called with the NBConnectResult
+        @param context  Passed to the callback
+        @return true if the connect started, false if one is running already or the queue is full
+     */
+    bool connectAsync(IPAddress ip, uint16_t port, NBConnectCallback callback, void *context = nullptr);
+
+    bool connectSSLAsync(IPAddress ip, uint16_t port, NBConnectCallback callback, void *context = nullptr);
+
+    /** Start connecting to a server by hostname, without waiting
+        The AT+USOCO command has to fit in the command queue, see MODEM_COMMAND_QUEUE_COMMAND_LENGTH.
+        Root certificates of an NBSSLClient are only loaded by its connect().
+        @param host     Hostname, must stay valid until the connect ended
+        @param port     Port
+        @param callback Called with the NBConnectResult
+        @param context  Passed to the callback
+        @return true if the connect started, false if one is running already, the queue is full
+                or the host name too long
+     */
+    bool connectAsync(const char *host, uint16_t port, NBConnectCallback callback, void *context = nullptr);
+
+    bool connectSSLAsync(const char *host, uint16_t port, NBConnectCallback callback, void *context = nullptr);
+
+    /** Get the socket of the modem the client uses
+        @return socket, -1 if none
+     */
+    int socket() const { return _socket; }
+
+    /** Check if a connect started with connectAsync() is running
+        @return true until its callback was called
+     */
+    bool connecting() const { return _connectState != 0; }
+
+    /** Get the time the phases of the last connect took
+        @return phase times, of the phases that completed
+     */
+    const NBConnectTimes &connectTimes() const { return _connectTimes; }
+
     /** Initialize write in request
         @param sync     Sync mode
      */
@@ -84,18 +184,69 @@ public:
     size_t write(const uint8_t *buf);
 
     /** Write a characters buffer with size in request
+        Chunks are sent stop-and-wait, one AT+USOWR per OK: the modem takes no
+        command before the previous one answered, and each chunk is hex encoded
+        while it goes out, so no encoding is left to overlap with the round
+        trip. A sync write sends chunk after chunk, an async write sends one
+        chunk per call and returns the bytes it took.
+        A chunk the modem rejects or only partly takes sets getWriteError(),
+        for the last chunk of an async write once ready() sees its result.
         @param (uint8_t*) Buffer
         @param (size_t)   Buffer size
-        @return buffer size
+        @return bytes collected or sent, less than size on a partial write
      */
     size_t write(const uint8_t *, size_t);
 
-    /** Finish write request
+    /** Write several buffers in request as one, without copying them together
+        Small writes are collected like any other write, larger ones are sent in
+        as few AT+USOWR commands as their total length allows.
+        @param segments Buffers and their lengths
+        @param count    Number of segments
+        @return bytes collected or sent, less than their total on a partial write
+     */
+    size_t write(const NBSegment *segments, size_t count);
+
+    /** Get the number of bytes that can be written without waiting for the send window
+        Asks the modem for its unacknowledged bytes (AT+USOCTL=<socket>,11) while
+        any were sent, at most every 100 ms. Collected writes count as written.
+        @return bytes, 0 while the send window is full
+     */
+    int availableForWrite();
+
+    /** Finish write request, sends the collected writes
         @param sync     Sync mode
      */
     void endWrite(bool sync = false);
 
+    /** Set the idle time after which collected writes are sent
+        Collected writes are also sent when the buffer is full, on flush(),
+        endWrite(), available(), read() and stop(). The timeout is checked
+        on write() and connected().
+        @param timeout  Idle time in milliseconds, 0 to only send on those calls
+     */
+    void setFlushTimeout(unsigned long timeout) { _flushTimeout = timeout; }
+
+    /** Set the most bytes the modem is left with unacknowledged
+        Before a chunk would go past the window the client asks the modem how many
+        bytes are still unacknowledged. A sync write waits for the window to open,
+        an async write returns the bytes sent so far.
+        @param window   Bytes, a chunk is always sent once everything was acknowledged
+     */
+    void setSendWindow(size_t window) { _sendWindow = window; }
+
+    /** Get the number of write calls
+        @return writes since the client was created
+     */
+    unsigned long writeCalls() const { return _writeCalls; }
+
+    /** Get the number of AT+USOWR commands the writes took
+        @return commands sent since the client was created
+     */
+    unsigned long writeCommands() const { return _writeCommands; }
+
     /** Check if connected to server
+        Follows the socket URCs, without AT commands. A socket the server closed
+        stays connected until the data received before was read.
         @return 1 if connected
      */
     uint8_t connected();
@@ -109,6 +260,32 @@ public:
      */
     int read(uint8_t *buf, size_t size);
 
+    /** Get the next received bytes without copying them
+        Waits for data like available(). The bytes stay in the receive buffer
+        until they are consumed, the pointer is valid until then.
+        @param data     Set to the first byte
+        @return number of contiguous bytes, 0 if none are available
+     */
+    size_t peekSpan(const uint8_t **data);
+
+    /** Drop received bytes, e.g. the ones returned by peekSpan()
+        @param length   Bytes
+     */
+    void consume(size_t length);
+
+    /** Read until a terminator, which is consumed but not stored, scanning the receive buffer in place
+        Stops after length bytes, or when no data arrives for the stream timeout.
+        @param terminator   Terminator
+        @param buffer       Destination
+        @param length       Size of the destination
+        @return number of bytes stored
+     */
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) {
+        return readBytesUntil(terminator, (char *) buffer, length);
+    }
+
     /** Read a character from response buffer
         @return character
      */
@@ -124,15 +301,70 @@ public:
      */
     int peek();
 
-    /** Flush response buffer
+    /** Send the collected writes
      */
     void flush();
 
     /** Stop client
+        The socket is closed in the background, from the command queue.
      */
     void stop();
 
-    virtual void handleUrc(const String &urc);
+    /** Let stop() use the asynchronous close of the firmware (AT+USOCL=<socket>,1)
+        The modem answers right away and reports the end of the connection with +UUSOCL.
+        @param fast     true for the asynchronous close
+     */
+    void setFastClose(bool fast) { _fastClose = fast; }
+
+    /* Socket options
+       Options set before connecting are sent as AT+USOSO commands once the socket is created and
+       before AT+USOCO, on every later connect too, options set while connected are queued right
+       away. The getters wait for those commands and ask the modem with AT+USOGO, they return -1
+       without socket or on an error. */
+
+    /** Send TCP keepalive probes on an idle connection, e.g. to keep a NAT mapping of the carrier
+        @param enable       true to send keepalive probes
+        @param idleMillis   Idle time before the first probe, in milliseconds, 0 for the modem default
+     */
+    void setKeepAlive(bool enable, unsigned long idleMillis = 0);
+
+    /** Disable the Nagle algorithm, so small writes are sent without waiting for acknowledgements
+        @param noDelay      true to disable Nagle
+     */
+    void setNoDelay(bool noDelay);
+
+    /** Let closing a socket wait until its data is sent
+        @param enable       true to linger
+        @param lingerMillis Longest time to linger, in milliseconds
+     */
+    void setLinger(bool enable, unsigned long lingerMillis = 0);
+
+    /** Set the IP type of service of the packets sent
+        @param tos          Type of service byte
+     */
+    void setTos(uint8_t tos);
+
+    /** Read the keepalive option of the socket
+        @param idleMillis   Filled with the idle time before the first probe, may be NULL
+        @return 1 if enabled, 0 if not, -1 on error
+     */
+    int getKeepAlive(unsigned long *idleMillis = NULL);
+
+    /** Read the Nagle option of the socket
+        @return 1 if Nagle is disabled, 0 if not, -1 on error
+     */
+    int getNoDelay();
+
+    /** Read the linger option of the socket
+        @param lingerMillis Filled with the linger time, may be NULL
+        @return 1 if enabled, 0 if not, -1 on error
+     */
+    int getLinger(unsigned long *lingerMillis = NULL);
+
+    /** Read the IP type of service of the socket
+        @return type of service byte, -1 on error
+     */
+    int getTos();
 
 protected:
     Modem &_modem;
@@ -140,6 +372,54 @@ protected:
 private:
     int connect();
 
+    bool connectAsync(NBConnectCallback callback, void *context);
+
+    static void connectStep(int result, const String &response, void *context);
+
+    void connectStep(int result, const String &response);
+
+    void connectSocket();
+
+    void connectNext(const char *command, unsigned long timeout, int state);
+
+    void connectFailed(int result);
+
+    void connectDone(int result);
+
+    bool connectCommand(char *command, size_t size);
+
+    unsigned long endPhase();
+
+    void waitReady();
+
+    size_t sendData(const uint8_t *buf, size_t size);
+
+    size_t sendData(const NBSegment *segments, size_t count);
+
+    size_t writeCompleted(int result);
+
+    bool updateUnacked();
+
+    void refreshUnacked();
+
+    static void unackedCompleted(int result, const String &response, void *context);
+
+    bool waitForWindow(size_t size);
+
+    bool flushTx();
+
+    void flushIfIdle();
+
+    void setOption(uint8_t option);
+
+    void startOptions();
+
+    void applyOptions();
+
+    static void optionCompleted(int result, const String &response, void *context);
+
+    bool queryOption(int level, int name, long &value, long *value2);
+
     bool _synch;
     int _socket;
     int _connected;
@@ -149,10 +429,40 @@ private:
     const char *_host;
     uint16_t _port;
     bool _ssl;
+    bool _fastClose;
+
+    int _connectState;
+    int _connectResult;
+    bool _connectAborted;
+    NBConnectCallback _connectCallback;
+    void *_connectContext;
+    NBConnectTimes _connectTimes;
+    unsigned long _phaseMillis;
 
     bool _writeSync;
     String _response;
-    NBSocketBuffer _nbSocketBuffer;
+
+    uint8_t _txBuffer[NB_CLIENT_TX_BUFFER_SIZE];
+    size_t _txLength;
+    unsigned long _txMillis;
+    unsigned long _flushTimeout;
+    unsigned long _writeCalls;
+    unsigned long _writeCommands;
+    size_t _writeInFlight;
+    size_t _sendWindow;
+    size_t _unacked;
+    unsigned long _unackedMillis;
+    bool _unackedQueued;
+
+    uint8_t _options;        // CLIENT_OPTION_... set by the sketch
+    uint8_t _optionsPending; // of those, still to send for the current socket
+    bool _optionInFlight;
+    bool _keepAlive;
+    unsigned long _keepIdle;
+    bool _noDelay;
+    bool _linger;
+    unsigned long _lingerTime;
+    uint8_t _tos;
 };
 
 #endif
@@ -0,0 +1,135 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "NBServer.h"
+
+NBServer::NBServer(Modem &modem, uint16_t port, bool synch) :
+        _modem(modem),
+        _port(port),
+        _synch(synch),
+        _socket(-1),
+        _first(0),
+        _count(0) {
+}
+
+NBServer::~NBServer() {
+    _modem.removeUrcHandler(this);
+}
+
+void NBServer::begin() {
+    String response;
+
+    if (_socket >= 0) {
+        return;
+    }
+
+    _modem.sockets().create(6);
+
+    if (_modem.waitForResponse(2000, &response) != 1 || !response.startsWith("+USOCR: ")) {
+        return;
+    }
+
+    _socket = response.charAt(response.length() - 1) - '0';
+    _modem.sockets().open(_socket);
+
+    if (!_modem.addUrcHandler(this, "+UUSOLI")) {
+        stop();
+        return;
+    }
+
+    _modem.sendf("AT+USOLI=%d,%d", _socket, _port);
+    if (_modem.waitForResponse(10000) != 1) {
+        stop();
+    }
+}
+
+NBClient NBServer::available() {
+    _modem.poll();
+
+    if (_count == 0) {
+        return NBClient(_modem, _synch);
+    }
+
+    int socket = _accepted[_first];
+
+    _first = (_first + 1) % NB_SERVER_BACKLOG;
+    _count--;
+
+    return NBClient(_modem, socket, _synch);
+}
+
+void NBServer::stop() {
+    _modem.removeUrcHandler(this);
+
+    for (; _count > 0; _count--) {
+        _modem.sockets().requestClose(_accepted[_first]);
+        _first = (_first + 1) % NB_SERVER_BACKLOG;
+    }
+
+    if (_socket >= 0) {
+        // the modem closes the socket in the background
+        _modem.sockets().requestClose(_socket);
+        _socket = -1;
+    }
+}
+
+size_t NBServer::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t NBServer::write(const uint8_t * /*buf*/, size_t /*size*/) {
+    return 0;
+}
+
+void NBServer::handleUrc(const char *urc) {
+    // +UUSOLI: <socket>,"<ip>",<port>,<listening socket>,"<local ip>",<listening port>
+    if (strncmp(urc, "+UUSOLI: ", 9) != 0) {
+        return;
+    }
+
+    int socket = atoi(urc + 9);
+    const char *listening = urc + 9;
+
+    for (int i = 0; i < 3 && listening != NULL; i++) {
+        listening = strchr(listening, ',');
+        if (listening != NULL) {
+            listening++;
+        }
+    }
+
+    if (listening == NULL || atoi(listening) != _socket || socket < 0 || socket >= MODEM_NUM_SOCKETS) {
+        return;
+    }
+
+    if (_count == NB_SERVER_BACKLOG) {
+        // nobody would ever read from it
+        _modem.sockets().requestClose(socket);
+        return;
+    }
+
+    // follow +UUSORD and +UUSOCL until available() hands the socket out
+    _modem.sockets().open(socket);
+
+    _accepted[(_first + _count) % NB_SERVER_BACKLOG] = socket;
+    _count++;
+}
@@ -0,0 +1,96 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _NB_SERVER_H_INCLUDED
+#define _NB_SERVER_H_INCLUDED
+
+#include <Server.h>
+
+#include "Modem.h"
+#include "NBClient.h"
+
+// Connections accepted and not handed out by available() yet, further ones are closed
+#ifndef NB_SERVER_BACKLOG
+#define NB_SERVER_BACKLOG 4
+#endif
+
+/*
+  TCP server on a listening socket of the modem. The modem accepts incoming
+  connections by itself and reports each with +UUSOLI, the server queues the
+  new socket ids from the URC, so waiting for connections sends no AT commands.
+*/
+class NBServer : public Server, public ModemUrcHandler {
+
+public:
+    /** Constructor
+        @param modem    Modem
+        @param port     Port to listen on
+        @param synch    Synchronous mode of the clients handed out
+     */
+    NBServer(Modem &modem, uint16_t port, bool synch = true);
+
+    virtual ~NBServer();
+
+    /** Create the socket and listen on the port
+     */
+    void begin();
+
+    /** Check if the server listens
+        @return true after a successful begin(), until stop()
+     */
+    bool listening() const { return _socket >= 0; }
+
+    /** Hand out the next accepted connection
+        @return client bound to the accepted socket, a client without socket if none is waiting
+     */
+    NBClient available();
+
+    /** Number of accepted connections available() can hand out
+        @return connections waiting
+     */
+    int accepted() const { return _count; }
+
+    /** Stop listening and close the connections not handed out
+     */
+    void stop();
+
+    /** Not supported, write through the clients available() hands out
+        @return 0
+     */
+    size_t write(uint8_t c);
+
+    size_t write(const uint8_t *buf, size_t size);
+
+    using Print::write;
+
+    virtual void handleUrc(const char *urc);
+
+private:
+    Modem &_modem;
+    uint16_t _port;
+    bool _synch;
+    int _socket;
+
+    int _accepted[NB_SERVER_BACKLOG];
+    int _first;
+    int _count;
+};
+
+#endif
@@ -0,0 +1,137 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "NBSocketPoller.h"
+
+NBSocketPoller::NBSocketPoller(Modem &modem) :
+        _modem(modem),
+        _count(0) {
+}
+
+bool NBSocketPoller::add(NBClient &client) {
+    return add(&client, nullptr);
+}
+
+bool NBSocketPoller::add(NBUDP &udp) {
+    return add(nullptr, &udp);
+}
+
+bool NBSocketPoller::add(NBClient *client, NBUDP *udp) {
+    for (int i = 0; i < _count; i++) {
+        if (_entries[i].client == client && _entries[i].udp == udp) {
+            return false;
+        }
+    }
+
+    if (_count >= NB_SOCKET_POLLER_SIZE) {
+        return false;
+    }
+
+    _entries[_count].client = client;
+    _entries[_count].udp = udp;
+    _entries[_count].events = 0;
+    _count++;
+
+    return true;
+}
+
+void NBSocketPoller::remove(NBClient &client) {
+    remove(&client, nullptr);
+}
+
+void NBSocketPoller::remove(NBUDP &udp) {
+    remove(nullptr, &udp);
+}
+
+void NBSocketPoller::remove(NBClient *client, NBUDP *udp) {
+    for (int i = 0; i < _count; i++) {
+        if (_entries[i].client == client && _entries[i].udp == udp) {
+            _entries[i] = _entries[--_count];
+            return;
+        }
+    }
+}
+
+int NBSocketPoller::poll(unsigned long timeout) {
+    unsigned long start = millis();
+
+    while (true) {
+        // URCs update the socket table
+        _modem.poll();
+
+        int ready = update();
+        unsigned long elapsed = millis() - start;
+
+        if (ready || elapsed >= timeout) {
+            return ready;
+        }
+
+        _modem.waitForData(timeout - elapsed);
+    }
+}
+
+int NBSocketPoller::events(const NBClient &client) const {
+    return events(&client, nullptr);
+}
+
+int NBSocketPoller::events(const NBUDP &udp) const {
+    return events(nullptr, &udp);
+}
+
+int NBSocketPoller::events(const NBClient *client, const NBUDP *udp) const {
+    for (int i = 0; i < _count; i++) {
+        if (_entries[i].client == client && _entries[i].udp == udp) {
+            return _entries[i].events;
+        }
+    }
+
+    return 0;
+}
+
+int NBSocketPoller::update() {
+    NBSocketTable &table = _modem.sockets();
+    int ready = 0;
+
+    for (int i = 0; i < _count; i++) {
+        Entry &entry = _entries[i];
+        int socket = entry.client != nullptr ? entry.client->socket() : entry.udp->socket();
+
+        entry.events = 0;
+
+        if (socket < 0) {
+            entry.events = NB_POLL_CLOSED;
+        } else {
+            // an unknown pending length may be data, the read finds out
+            if (table.buffered(socket) > 0 || table.pending(socket) != 0) {
+                entry.events |= NB_POLL_READABLE;
+            }
+
+            if (table.closed(socket)) {
+                entry.events |= NB_POLL_CLOSED;
+            }
+        }
+
+        if (entry.events) {
+            ready++;
+        }
+    }
+
+    return ready;
+}
@@ -0,0 +1,97 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _NB_SOCKET_POLLER_H_INCLUDED
+#define _NB_SOCKET_POLLER_H_INCLUDED
+
+#include "Modem.h"
+#include "NBClient.h"
+#include "NBUdp.h"
+
+// Clients and UDP sockets a poller can watch
+#ifndef NB_SOCKET_POLLER_SIZE
+#define NB_SOCKET_POLLER_SIZE MODEM_NUM_SOCKETS
+#endif
+
+// Events reported for a watched socket
+#define NB_POLL_READABLE 0x01 // data buffered or announced by +UUSORD/+UUSORF
+#define NB_POLL_CLOSED 0x02   // no socket, or the modem closed it
+
+/*
+  Waits for any of several NBClient and NBUDP sockets to become readable or
+  closed, like select(). The poller only looks at the state the socket table
+  keeps from the socket URCs, it sends no AT commands.
+*/
+class NBSocketPoller {
+
+public:
+    NBSocketPoller(Modem &modem);
+
+    /** Watch a client
+        @param client   Client, must stay valid while watched
+        @return true if added, false if already watched or the poller is full
+     */
+    bool add(NBClient &client);
+
+    /** Watch a UDP socket
+        @param udp      UDP socket, must stay valid while watched
+        @return true if added, false if already watched or the poller is full
+     */
+    bool add(NBUDP &udp);
+
+    void remove(NBClient &client);
+
+    void remove(NBUDP &udp);
+
+    /** Wait until a watched socket is readable or closed
+        @param timeout  Longest wait, in milliseconds, 0 to only check
+        @return number of watched sockets with events
+     */
+    int poll(unsigned long timeout = 0);
+
+    /** Get the events the last poll() found for a socket
+        @param client   Watched client
+        @return NB_POLL_READABLE and NB_POLL_CLOSED bits, 0 if none
+     */
+    int events(const NBClient &client) const;
+
+    int events(const NBUDP &udp) const;
+
+private:
+    struct Entry {
+        NBClient *client;
+        NBUDP *udp;
+        uint8_t events;
+    };
+
+    Modem &_modem;
+    Entry _entries[NB_SOCKET_POLLER_SIZE];
+    int _count;
+
+    bool add(NBClient *client, NBUDP *udp);
+
+    void remove(NBClient *client, NBUDP *udp);
+
+    int events(const NBClient *client, const NBUDP *udp) const;
+
+    int update();
+};
+
+#endif
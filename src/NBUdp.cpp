@@ -17,39 +17,41 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "Modem.h"
 
+#include "utility/NBHex.h"
+
 #include "NBUdp.h"
 
 NBUDP::NBUDP(Modem &modem) :
         _modem(modem),
         _socket(-1),
-        _packetReceived(false),
         _txIp((uint32_t) 0),
         _txHost(NULL),
         _txPort(0),
         _txSize(0),
         _rxIp((uint32_t) 0),
-        _rxPort(0),
-        _rxSize(0),
-        _rxIndex(0) {
-    _modem.addUrcHandler(this);
+        _rxPort(0) {
 }
 
 NBUDP::~NBUDP() {
-    _modem.removeUrcHandler(this);
 }
 
 uint8_t NBUDP::begin(uint16_t port) {
     String response;
 
-    _modem.send("AT+USOCR=17");
+    _modem.sockets().create(17);
 
     if (_modem.waitForResponse(2000, &response) != 1) {
         return 0;
     }
 
     _socket = response.charAt(response.length() - 1) - '0';
+    _modem.sockets().open(_socket, true);
 
     _modem.sendf("AT+USOLI=%d,%d", _socket, port);
     if (_modem.waitForResponse(10000) != 1) {
@@ -61,17 +63,21 @@ uint8_t NBUDP::begin(uint16_t port) {
 }
 
 void NBUDP::stop() {
+    updateSocketState();
+
     if (_socket < 0) {
         return;
     }
 
-    _modem.sendf("AT+USOCL=%d", _socket);
-    _modem.waitForResponse(10000);
+    // the modem closes the socket in the background
+    _modem.sockets().requestClose(_socket);
 
     _socket = -1;
 }
 
 int NBUDP::beginPacket(IPAddress ip, uint16_t port) {
+    updateSocketState();
+
     if (_socket < 0) {
         return 0;
     }
@@ -85,6 +91,8 @@ int NBUDP::beginPacket(IPAddress ip, uint16_t port) {
 }
 
 int NBUDP::beginPacket(const char *host, uint16_t port) {
+    updateSocketState();
+
     if (_socket < 0) {
         return 0;
     }
@@ -98,49 +106,43 @@ int NBUDP::beginPacket(const char *host, uint16_t port) {
 }
 
 int NBUDP::endPacket() {
-    String command;
+    return endPacket(NULL, 0);
+}
 
-    if (_txHost != NULL) {
-        command.reserve(26 + strlen(_txHost) + _txSize * 2);
-    } else {
-        command.reserve(41 + _txSize * 2);
+int NBUDP::endPacket(const NBSegment *segments, size_t count) {
+    // room for a host name of up to 255 characters, the payload is hex encoded straight to the modem
+    char command[288];
+    NBSegment payload[NB_UDP_MAX_SEGMENTS + 1] = {{_txBuffer, _txSize}};
+    size_t size = _txSize;
+    int length;
+
+    if (count > NB_UDP_MAX_SEGMENTS) {
+        return 0;
     }
 
-    command += "AT+USOST=";
-    command += _socket;
-    command += ",\"";
+    for (size_t i = 0; i < count; i++) {
+        payload[i + 1] = segments[i];
+        size += segments[i].length;
+    }
+
+    if (size > sizeof(_txBuffer)) {
+        return 0;
+    }
 
     if (_txHost != NULL) {
-        command += _txHost;
+        length = snprintf(command, sizeof(command), "AT+USOST=%d,\"%s\",%u,%u,\"",
+                          _socket, _txHost, (unsigned int) _txPort, (unsigned int) size);
     } else {
-        command += _txIp[0];
-        command += '.';
-        command += _txIp[1];
-        command += '.';
-        command += _txIp[2];
-        command += '.';
-        command += _txIp[3];
+        length = snprintf(command, sizeof(command), "AT+USOST=%d,\"%d.%d.%d.%d\",%u,%u,\"",
+                          _socket, _txIp[0], _txIp[1], _txIp[2], _txIp[3], (unsigned int) _txPort, (unsigned int) size);
     }
 
-    command += "\",";
-    command += _txPort;
-    command += ",",
-            command += _txSize;
-    command += ",\"";
-
-    for (size_t i = 0; i < _txSize; i++) {
-        byte b = _txBuffer[i];
-
-        byte n1 = (b >> 4) & 0x0f;
-        byte n2 = (b & 0x0f);
-
-        command += (char) (n1 > 9 ? 'A' + n1 - 10 : '0' + n1);
-        command += (char) (n2 > 9 ? 'A' + n2 - 10 : '0' + n2);
+    // host name too long for the command
+    if (length < 0 || (size_t) length >= sizeof(command)) {
+        return 0;
     }
 
-    command += "\"";
-
-    _modem.send(command);
+    _modem.sendHex(command, payload, count + 1, 0, size, "\"");
 
     if (_modem.waitForResponse() == 1) {
         return 1;
@@ -172,84 +174,28 @@ size_t NBUDP::write(const uint8_t *buffer, size_t size) {
 
 int NBUDP::parsePacket() {
     _modem.poll();
+    updateSocketState();
 
     if (_socket < 0) {
         return 0;
     }
 
-    if (!_packetReceived) {
-        return 0;
-    }
-    _packetReceived = false;
-
-    String response;
-
-    _modem.sendf("AT+USORF=%d,%d", _socket, sizeof(_rxBuffer));
-    if (_modem.waitForResponse(10000, &response) != 1) {
-        return 0;
-    }
-
-    if (!response.startsWith("+USORF: ")) {
-        return 0;
-    }
-
-    response.remove(0, 11);
-
-    int firstQuoteIndex = response.indexOf('"');
-    if (firstQuoteIndex == -1) {
-        return 0;
-    }
-
-    String ip = response.substring(0, firstQuoteIndex);
-    _rxIp.fromString(ip);
-
-    response.remove(0, firstQuoteIndex + 2);
-
-    int firstCommaIndex = response.indexOf(',');
-    if (firstCommaIndex == -1) {
-        return 0;
-    }
-
-    String port = response.substring(0, firstCommaIndex);
-    _rxPort = port.toInt();
-    firstQuoteIndex = response.indexOf("\"");
-
-    response.remove(0, firstQuoteIndex + 1);
-    response.remove(response.length() - 1);
-
-    _rxIndex = 0;
-    _rxSize = response.length() / 2;
-
-    for (size_t i = 0; i < _rxSize; i++) {
-        byte n1 = response[i * 2];
-        byte n2 = response[i * 2 + 1];
-
-        if (n1 > '9') {
-            n1 = (n1 - 'A') + 10;
-        } else {
-            n1 = (n1 - '0');
-        }
-
-        if (n2 > '9') {
-            n2 = (n2 - 'A') + 10;
-        } else {
-            n2 = (n2 - '0');
-        }
-
-        _rxBuffer[i] = (n1 << 4) | n2;
-    }
+    // nothing announced by +UUSORF reads nothing
+    int size = _modem.sockets().receiveFrom(_socket, _rxIp, _rxPort);
 
     _modem.poll();
 
-    return _rxSize;
+    return size;
 }
 
 int NBUDP::available() {
+    updateSocketState();
+
     if (_socket < 0) {
         return 0;
     }
 
-    return (_rxIndex - _rxSize);
+    return _modem.sockets().buffered(_socket);
 }
 
 int NBUDP::read() {
@@ -263,25 +209,19 @@ int NBUDP::read() {
 }
 
 int NBUDP::read(unsigned char *buffer, size_t len) {
-    size_t readMax = available();
-
-    if (len > readMax) {
-        len = readMax;
+    if (available() == 0) {
+        return 0;
     }
 
-    memcpy(buffer, &_rxBuffer[_rxIndex], len);
-
-    _rxIndex += len;
-
-    return len;
+    return _modem.sockets().read(_socket, buffer, len);
 }
 
 int NBUDP::peek() {
-    if (available() > 1) {
-        return _rxBuffer[_rxIndex];
+    if (available() == 0) {
+        return -1;
     }
 
-    return -1;
+    return _modem.sockets().peek(_socket);
 }
 
 void NBUDP::flush() {
@@ -295,21 +235,10 @@ uint16_t NBUDP::remotePort() {
     return _rxPort;
 }
 
-void NBUDP::handleUrc(const String &urc) {
-    if (urc.startsWith("+UUSORF: ")) {
-        int socket = urc.charAt(9) - '0';
-
-        if (socket == _socket) {
-            _packetReceived = true;
-        }
-    } else if (urc.startsWith("+UUSOCL: ")) {
-        int socket = urc.charAt(urc.length() - 1) - '0';
-
-        if (socket == _socket) {
-            // this socket closed
-            _socket = -1;
-            _rxIndex = 0;
-            _rxSize = 0;
-        }
+void NBUDP::updateSocketState() {
+    // the modem closed the socket
+    if (_socket >= 0 && _modem.sockets().closed(_socket)) {
+        _modem.sockets().close(_socket);
+        _socket = -1;
     }
 }
@@ -23,8 +23,14 @@
 #include <Udp.h>
 
 #include "Modem.h"
+#include "utility/NBHex.h"
 
-class NBUDP : public UDP, public ModemUrcHandler {
+// Most segments endPacket(segments, count) appends to a packet
+#ifndef NB_UDP_MAX_SEGMENTS
+#define NB_UDP_MAX_SEGMENTS 8
+#endif
+
+class NBUDP : public UDP {
 
 public:
     NBUDP(Modem &modem);  // Constructor
@@ -48,6 +54,11 @@ public:
     // Returns 1 if the packet was sent successfully, 0 if there was an error
     virtual int endPacket();
 
+    // Finish off this packet with the segments appended, hex encoded straight from their buffers
+    // Returns 1 if the packet was sent successfully, 0 if there was an error, it is larger than 512 bytes
+    // or has more than NB_UDP_MAX_SEGMENTS segments
+    int endPacket(const NBSegment *segments, size_t count);
+
     // Write a single byte into the packet
     virtual size_t write(uint8_t);
 
@@ -85,12 +96,12 @@ public:
     // Return the port of the host who sent the current incoming packet
     virtual uint16_t remotePort();
 
-    virtual void handleUrc(const String &urc);
+    // Return the socket of the modem, -1 if none
+    int socket() const { return _socket; }
 
 private:
     Modem &_modem;
     int _socket;
-    bool _packetReceived;
 
     IPAddress _txIp;
     const char *_txHost;
@@ -98,11 +109,11 @@ private:
     size_t _txSize;
     uint8_t _txBuffer[512];
 
+    // the datagram itself is in the receive buffer of the socket table
     IPAddress _rxIp;
     uint16_t _rxPort;
-    size_t _rxSize;
-    size_t _rxIndex;
-    uint8_t _rxBuffer[512];
+
+    void updateSocketState();
 };
 
 #endif
@@ -44,7 +44,9 @@ size_t NB_SMS::write(uint8_t c) {
 
 int NB_SMS::beginSMS(const char *to) {
     _modem.sendf("AT+CMGS=\"%s\"", to);
-    if (_modem.waitForResponse(100) == 2) {
+    _modem.expectPrompt();
+    int status = _modem.waitForResponse(100);
+    if (status > MODEM_RESULT_OK && status != MODEM_RESULT_PROMPT) {
         _smsTxActive = false;
 
         return (_synch) ? 0 : 2;
@@ -93,7 +95,7 @@ int NB_SMS::endSMS() {
 
         if (_synch) {
             while ((r = _modem.ready()) == 0) {
-                delay(100);
+                _modem.waitForData(100);
             }
         } else {
             r = _modem.ready();
@@ -125,7 +127,7 @@ int NB_SMS::available() {
 
         if (_synch) {
             while ((r = ready()) == 0) {
-                delay(100);
+                _modem.waitForData(100);
             }
         } else {
             r = ready();
@@ -203,7 +205,9 @@ void NB_SMS::flush() {
     int smsIndexEnd = _incomingBuffer.indexOf(',');
 
     if (smsIndexStart != -1 && smsIndexEnd != -1) {
-        while (_modem.ready() == 0);
+        while (_modem.ready() == 0) {
+            _modem.waitForData(100);
+        }
 
         _modem.sendf("AT+CMGD=%s", _incomingBuffer.substring(smsIndexStart + 1, smsIndexEnd).c_str());
 
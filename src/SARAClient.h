@@ -30,6 +30,8 @@
 
 #include "NBSSLClient.h"
 #include "NBUdp.h"
+#include "NBSocketPoller.h"
+#include "NBServer.h"
 
 #ifdef TRAVIS_CI
 
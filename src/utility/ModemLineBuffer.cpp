@@ -0,0 +1,69 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <ctype.h>
+#include <string.h>
+
+#include "ModemLineBuffer.h"
+
+ModemLineBuffer::ModemLineBuffer() {
+    clear();
+}
+
+void ModemLineBuffer::clear() {
+    _data[0] = '\0';
+    _length = 0;
+    _complete = false;
+    _overflowed = false;
+}
+
+bool ModemLineBuffer::complete() {
+    if (_length && _data[_length - 1] == '\r') {
+        _length--;
+    }
+
+    _data[_length] = '\0';
+    _complete = true;
+
+    return true;
+}
+
+const char *ModemLineBuffer::trim() {
+    while (_length && isspace((unsigned char) _data[_length - 1])) {
+        _length--;
+    }
+    _data[_length] = '\0';
+
+    const char *start = _data;
+    while (isspace((unsigned char) *start)) {
+        start++;
+    }
+
+    return start;
+}
+
+bool ModemLineBuffer::startsWith(const char *prefix) const {
+    size_t prefixLength = strlen(prefix);
+
+    return _length >= prefixLength && memcmp(_data, prefix, prefixLength) == 0;
+}
+
+bool ModemLineBuffer::equals(const char *str) const {
+    return strlen(str) == _length && memcmp(_data, str, _length) == 0;
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _MODEM_LINE_BUFFER_H_INCLUDED
+#define _MODEM_LINE_BUFFER_H_INCLUDED
+
+#include <stddef.h>
+
+// Large enough for a +USORF response carrying 512 hex encoded bytes
+#ifndef MODEM_LINE_BUFFER_SIZE
+#define MODEM_LINE_BUFFER_SIZE 1088
+#endif
+
+class ModemLineBuffer {
+
+public:
+    ModemLineBuffer();
+
+    /** Append a received character, inline as poll() calls it for every byte
+        @param c        Character
+        @return true once a complete line, without its <CR><LF>, is available
+     */
+    bool feed(char c) {
+        if (_complete) {
+            clear();
+        }
+
+        if (c == '\n') {
+            return complete();
+        }
+
+        if (_length < MODEM_LINE_BUFFER_SIZE) {
+            _data[_length++] = c;
+        } else {
+            _overflowed = true;
+        }
+
+        return false;
+    }
+
+    /** Discard the line being assembled
+     */
+    void clear();
+
+    /** Check if the next character starts a new line
+        @return true if nothing of the current line was received yet
+     */
+    bool atLineStart() const { return _complete || _length == 0; }
+
+    /** Check if characters of the current line were dropped
+        @return true if the line did not fit in MODEM_LINE_BUFFER_SIZE
+     */
+    bool overflowed() const { return _overflowed; }
+
+    const char *line() const { return _data; }
+
+    /** Strip surrounding whitespace from the completed line, in place
+        @return start of the trimmed line
+     */
+    const char *trim();
+
+    size_t length() const { return _length; }
+
+    bool startsWith(const char *prefix) const;
+
+    bool equals(const char *str) const;
+
+private:
+    bool complete();
+
+    char _data[MODEM_LINE_BUFFER_SIZE + 1];
+    size_t _length;
+    bool _complete;
+    bool _overflowed;
+};
+
+#endif
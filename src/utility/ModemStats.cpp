@@ -0,0 +1,180 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ModemStats.h"
+
+static const unsigned long BUCKET_LIMITS_MS[MODEM_STATS_HISTOGRAM_BUCKETS - 1] = {
+        10, 25, 50, 100, 250, 1000, 10000
+};
+
+uint32_t ModemCommandStats::meanMicros() const {
+    uint32_t completed = count - timeouts;
+
+    return completed ? (uint32_t) (totalMicros / completed) : 0;
+}
+
+ModemStats::ModemStats() {
+    reset();
+}
+
+void ModemStats::reset() {
+    memset(_commands, 0, sizeof(_commands));
+    _verbCount = 0;
+    _pending = -1;
+    _sentMicros = 0;
+    _bytesSent = 0;
+    _bytesReceived = 0;
+    _urcs = 0;
+    _overflows = 0;
+    _guardMillis = 0;
+}
+
+unsigned long ModemStats::bucketLimitMillis(int bucket) {
+    return bucket < MODEM_STATS_HISTOGRAM_BUCKETS - 1 ? BUCKET_LIMITS_MS[bucket] : 0;
+}
+
+int ModemStats::lookup(const char *verb, size_t length) {
+    if (length > MODEM_STATS_VERB_LENGTH) {
+        length = MODEM_STATS_VERB_LENGTH;
+    }
+
+    for (int i = 0; i < _verbCount; i++) {
+        if (strncmp(_commands[i].verb, verb, length) == 0 && _commands[i].verb[length] == '\0') {
+            return i;
+        }
+    }
+
+    if (_verbCount == MODEM_STATS_MAX_VERBS) {
+        // the table is full, the last entry is "other"
+        return _verbCount - 1;
+    }
+
+    if (_verbCount == MODEM_STATS_MAX_VERBS - 1) {
+        verb = "other";
+        length = 5;
+    }
+
+    ModemCommandStats &stats = _commands[_verbCount];
+
+    memcpy(stats.verb, verb, length);
+    stats.verb[length] = '\0';
+    stats.minMicros = UINT32_MAX;
+
+    return _verbCount++;
+}
+
+const ModemCommandStats *ModemStats::find(const char *verb) const {
+    for (int i = 0; i < _verbCount; i++) {
+        if (strcmp(_commands[i].verb, verb) == 0) {
+            return &_commands[i];
+        }
+    }
+
+    return nullptr;
+}
+
+void ModemStats::commandSent(const char *command, unsigned long nowMicros) {
+    // the verb ends at the parameters of a set command, "=?" of a test command is kept
+    size_t length = strcspn(command, "=");
+    if (command[length] == '=' && command[length + 1] == '?') {
+        length += 2;
+    }
+
+    _pending = lookup(command, length);
+    _sentMicros = nowMicros;
+    _commands[_pending].count++;
+}
+
+void ModemStats::commandCompleted(int result, unsigned long nowMicros) {
+    if (_pending < 0) {
+        return;
+    }
+
+    ModemCommandStats &stats = _commands[_pending];
+    uint32_t latency = nowMicros - _sentMicros;
+    int bucket = 0;
+
+    _pending = -1;
+
+    if (result > 1) {
+        stats.errors++;
+    }
+
+    if (latency < stats.minMicros) {
+        stats.minMicros = latency;
+    }
+    if (latency > stats.maxMicros) {
+        stats.maxMicros = latency;
+    }
+    stats.totalMicros += latency;
+
+    while (bucket < MODEM_STATS_HISTOGRAM_BUCKETS - 1 && latency >= BUCKET_LIMITS_MS[bucket] * 1000) {
+        bucket++;
+    }
+
+    if (stats.histogram[bucket] < UINT16_MAX) {
+        stats.histogram[bucket]++;
+    }
+}
+
+void ModemStats::commandTimedOut() {
+    if (_pending < 0) {
+        return;
+    }
+
+    _commands[_pending].timeouts++;
+    _pending = -1;
+}
+
+void ModemStats::dump(Print &out) const {
+    char line[128];
+
+    snprintf(line, sizeof(line), "%-15s %6s %4s %4s %11s %11s %11s", "verb", "count", "err", "tmo", "min ms", "mean ms",
+             "max ms");
+    out.print(line);
+    out.println("  <10  <25  <50 <100 <250  <1s <10s >10s");
+
+    for (int i = 0; i < _verbCount; i++) {
+        const ModemCommandStats &stats = _commands[i];
+        uint32_t minMicros = stats.count > stats.timeouts ? stats.minMicros : 0;
+        int n;
+
+        n = snprintf(line, sizeof(line), "%-15s %6lu %4lu %4lu %9lu.%01lu %9lu.%01lu %9lu.%01lu",
+                     stats.verb, (unsigned long) stats.count, (unsigned long) stats.errors,
+                     (unsigned long) stats.timeouts,
+                     (unsigned long) (minMicros / 1000), (unsigned long) (minMicros / 100 % 10),
+                     (unsigned long) (stats.meanMicros() / 1000), (unsigned long) (stats.meanMicros() / 100 % 10),
+                     (unsigned long) (stats.maxMicros / 1000), (unsigned long) (stats.maxMicros / 100 % 10));
+
+        for (int bucket = 0; bucket < MODEM_STATS_HISTOGRAM_BUCKETS && n > 0 && n < (int) sizeof(line); bucket++) {
+            n += snprintf(line + n, sizeof(line) - n, " %4u", stats.histogram[bucket]);
+        }
+
+        out.println(line);
+    }
+
+    snprintf(line, sizeof(line), "tx %lu B, rx %lu B, %lu URCs, %lu overflows, guard %lu ms",
+             (unsigned long) _bytesSent, (unsigned long) _bytesReceived, (unsigned long) _urcs,
+             (unsigned long) _overflows, (unsigned long) _guardMillis);
+    out.println(line);
+}
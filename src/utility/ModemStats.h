@@ -0,0 +1,123 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _MODEM_STATS_H_INCLUDED
+#define _MODEM_STATS_H_INCLUDED
+
+#include <Arduino.h>
+
+// Distinct command verbs tracked, further verbs are counted under "other"
+#ifndef MODEM_STATS_MAX_VERBS
+#define MODEM_STATS_MAX_VERBS 24
+#endif
+
+#define MODEM_STATS_VERB_LENGTH 15
+#define MODEM_STATS_HISTOGRAM_BUCKETS 8
+
+// Statistics of one command verb, e.g. "AT+USORD" or "AT+CEREG?"
+struct ModemCommandStats {
+    char verb[MODEM_STATS_VERB_LENGTH + 1];
+    uint32_t count;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t minMicros;
+    uint32_t maxMicros;
+    uint64_t totalMicros;
+    // send-to-final-result latency, see ModemStats::bucketLimitMillis
+    uint16_t histogram[MODEM_STATS_HISTOGRAM_BUCKETS];
+
+    uint32_t meanMicros() const;
+};
+
+class ModemStats {
+
+public:
+    ModemStats();
+
+    void reset();
+
+    /** Get the number of tracked command verbs
+        @return verbs, including "other" once the table is full
+     */
+    int verbs() const { return _verbCount; }
+
+    const ModemCommandStats &verb(int index) const { return _commands[index]; }
+
+    /** Find the statistics of a command verb
+        @param verb     Verb, e.g. "AT+USOWR"
+        @return statistics, nullptr if the verb was not sent
+     */
+    const ModemCommandStats *find(const char *verb) const;
+
+    /** Get the upper limit of a latency histogram bucket
+        @param bucket   Bucket index
+        @return limit in milliseconds, 0 for the last, unbounded, bucket
+     */
+    static unsigned long bucketLimitMillis(int bucket);
+
+    uint32_t bytesSent() const { return _bytesSent; }
+
+    uint32_t bytesReceived() const { return _bytesReceived; }
+
+    uint32_t urcs() const { return _urcs; }
+
+    // lines longer than MODEM_LINE_BUFFER_SIZE, dropped
+    uint32_t overflows() const { return _overflows; }
+
+    // time spent waiting for the MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS guard
+    uint32_t guardMillis() const { return _guardMillis; }
+
+    /** Print one line per verb and a line of totals
+        @param out      Output, e.g. Serial
+     */
+    void dump(Print &out) const;
+
+    // hooks called by Modem
+    void commandSent(const char *command, unsigned long nowMicros);
+
+    void commandCompleted(int result, unsigned long nowMicros);
+
+    void commandTimedOut();
+
+    void addBytesSent(size_t count) { _bytesSent += count; }
+
+    void addBytesReceived(size_t count) { _bytesReceived += count; }
+
+    void urcReceived() { _urcs++; }
+
+    void lineOverflowed() { _overflows++; }
+
+    void addGuardMillis(unsigned long ms) { _guardMillis += ms; }
+
+private:
+    ModemCommandStats _commands[MODEM_STATS_MAX_VERBS];
+    int _verbCount;
+    int _pending;
+    unsigned long _sentMicros;
+    uint32_t _bytesSent;
+    uint32_t _bytesReceived;
+    uint32_t _urcs;
+    uint32_t _overflows;
+    uint32_t _guardMillis;
+
+    int lookup(const char *command, size_t length);
+};
+
+#endif
@@ -0,0 +1,235 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+
+#include "ModemTrace.h"
+
+ModemTrace::ModemTrace() :
+        _started(false),
+        _lastMillis(0),
+        _direction(MODEM_TRACE_TX),
+        _pendingMillis(0),
+        _pendingLength(0) {
+}
+
+void ModemTrace::record(uint8_t direction, const uint8_t *data, size_t length, unsigned long ms) {
+    while (length) {
+        if (_pendingLength && (direction != _direction || ms != _pendingMillis ||
+                               _pendingLength == MODEM_TRACE_MAX_RECORD)) {
+            flush();
+        }
+
+        if (_pendingLength == 0) {
+            _direction = direction;
+            _pendingMillis = ms;
+        }
+
+        size_t chunk = MODEM_TRACE_MAX_RECORD - _pendingLength;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        memcpy(_pending + _pendingLength, data, chunk);
+        _pendingLength += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+void ModemTrace::flush() {
+    if (_pendingLength == 0) {
+        return;
+    }
+
+    uint8_t header[MODEM_TRACE_MAX_HEADER];
+    unsigned long delta = _started ? _pendingMillis - _lastMillis : 0;
+    size_t headerLength = encodeHeader(header, _direction, _pendingLength, delta);
+
+    store(header, headerLength, _pending, _pendingLength, _pendingMillis);
+
+    _started = true;
+    _lastMillis = _pendingMillis;
+    _pendingLength = 0;
+}
+
+size_t ModemTrace::encodeHeader(uint8_t *header, uint8_t direction, size_t length, unsigned long delta) {
+    size_t headerLength = 0;
+
+    header[headerLength++] = direction | (uint8_t) (length - 1);
+
+    do {
+        uint8_t b = delta & 0x7f;
+
+        delta >>= 7;
+        header[headerLength++] = delta ? (b | 0x80) : b;
+    } while (delta);
+
+    return headerLength;
+}
+
+size_t ModemTrace::decodeHeader(const uint8_t *header, size_t available, size_t &length, unsigned long &delta) {
+    if (available < 2) {
+        return 0;
+    }
+
+    length = (header[0] & 0x7f) + 1;
+    delta = 0;
+
+    for (size_t i = 1; i < available && i < MODEM_TRACE_MAX_HEADER; i++) {
+        delta |= (unsigned long) (header[i] & 0x7f) << (7 * (i - 1));
+
+        if (!(header[i] & 0x80)) {
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+void ModemTrace::writeFileHeader(Print &out, unsigned long baseMillis) {
+    uint8_t base[4] = {
+            (uint8_t) baseMillis,
+            (uint8_t) (baseMillis >> 8),
+            (uint8_t) (baseMillis >> 16),
+            (uint8_t) (baseMillis >> 24)
+    };
+
+    out.write((const uint8_t *) MODEM_TRACE_MAGIC, 4);
+    out.write(base, sizeof(base));
+}
+
+ModemPrintTrace::ModemPrintTrace(Print &out) :
+        _out(out),
+        _headerWritten(false) {
+}
+
+ModemPrintTrace::~ModemPrintTrace() {
+    flush();
+}
+
+void ModemPrintTrace::store(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t length,
+                            unsigned long ms) {
+    if (!_headerWritten) {
+        writeFileHeader(_out, ms);
+        _headerWritten = true;
+    }
+
+    _out.write(header, headerLength);
+    _out.write(payload, length);
+}
+
+ModemRingTrace::ModemRingTrace(uint8_t *buffer, size_t size) :
+        _buffer(buffer),
+        _size(size) {
+    clear();
+}
+
+void ModemRingTrace::clear() {
+    _tail = 0;
+    _length = 0;
+    _tailMillis = 0;
+}
+
+size_t ModemRingTrace::copyOut(size_t offset, uint8_t *data, size_t length) const {
+    if (offset >= _length) {
+        return 0;
+    }
+
+    if (length > _length - offset) {
+        length = _length - offset;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        data[i] = _buffer[(_tail + offset + i) % _size];
+    }
+
+    return length;
+}
+
+void ModemRingTrace::dropOldest() {
+    uint8_t header[MODEM_TRACE_MAX_HEADER];
+    size_t length;
+    unsigned long delta;
+    size_t headerLength = decodeHeader(header, copyOut(0, header, sizeof(header)), length, delta);
+
+    if (headerLength == 0 || headerLength + length >= _length) {
+        clear();
+        return;
+    }
+
+    _tail = (_tail + headerLength + length) % _size;
+    _length -= headerLength + length;
+
+    // the new oldest record is timed relative to the dropped one
+    decodeHeader(header, copyOut(0, header, sizeof(header)), length, delta);
+    _tailMillis += delta;
+}
+
+void ModemRingTrace::store(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t length,
+                           unsigned long ms) {
+    size_t recordLength = headerLength + length;
+
+    if (recordLength > _size) {
+        return;
+    }
+
+    while (_size - _length < recordLength) {
+        dropOldest();
+    }
+
+    if (_length == 0) {
+        _tailMillis = ms;
+    }
+
+    for (size_t i = 0; i < recordLength; i++) {
+        _buffer[(_tail + _length + i) % _size] = i < headerLength ? header[i] : payload[i - headerLength];
+    }
+    _length += recordLength;
+}
+
+void ModemRingTrace::dump(Print &out) {
+    uint8_t header[MODEM_TRACE_MAX_HEADER];
+    size_t length;
+    unsigned long delta;
+
+    flush();
+    writeFileHeader(out, _tailMillis);
+
+    size_t headerLength = decodeHeader(header, copyOut(0, header, sizeof(header)), length, delta);
+    if (headerLength == 0) {
+        return;
+    }
+
+    // the first record starts at the base time of the trace
+    out.write(header, encodeHeader(header, header[0] & MODEM_TRACE_RX, length, 0));
+
+    for (size_t offset = headerLength; offset < _length;) {
+        size_t start = (_tail + offset) % _size;
+        size_t span = _size - start;
+
+        if (span > _length - offset) {
+            span = _length - offset;
+        }
+
+        out.write(_buffer + start, span);
+        offset += span;
+    }
+}
@@ -0,0 +1,143 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _MODEM_TRACE_H_INCLUDED
+#define _MODEM_TRACE_H_INCLUDED
+
+#include <Arduino.h>
+
+/*
+  Binary UART trace format
+
+  A trace starts with the magic "SRT1" and the little endian 32-bit millis()
+  of its first record, followed by records of
+    - a header byte, MODEM_TRACE_RX for bytes received from the modem, or'ed
+      with the payload length minus one (1 to MODEM_TRACE_MAX_RECORD bytes)
+    - the milliseconds since the previous record, as a LEB128 varint
+    - the payload
+  Consecutive bytes of the same direction and millisecond share a record.
+*/
+#define MODEM_TRACE_MAGIC "SRT1"
+#define MODEM_TRACE_TX 0x00
+#define MODEM_TRACE_RX 0x80
+#define MODEM_TRACE_MAX_RECORD 128
+#define MODEM_TRACE_MAX_HEADER 6
+
+class ModemTrace {
+
+public:
+    ModemTrace();
+
+    virtual ~ModemTrace() {}
+
+    /** Record bytes sent to or received from the modem
+        @param direction    MODEM_TRACE_TX or MODEM_TRACE_RX
+        @param data         Bytes
+        @param length       Number of bytes
+        @param ms           millis() of the transfer
+     */
+    void record(uint8_t direction, const uint8_t *data, size_t length, unsigned long ms);
+
+    /** Store the record being assembled
+     */
+    void flush();
+
+protected:
+    /** Store one encoded record
+        @param header       Header byte and time delta
+        @param headerLength Length of the header
+        @param payload      Payload
+        @param length       Length of the payload
+        @param ms           millis() of the record
+     */
+    virtual void store(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t length,
+                       unsigned long ms) = 0;
+
+    static size_t encodeHeader(uint8_t *header, uint8_t direction, size_t length, unsigned long delta);
+
+    static size_t decodeHeader(const uint8_t *header, size_t available, size_t &length, unsigned long &delta);
+
+    static void writeFileHeader(Print &out, unsigned long baseMillis);
+
+private:
+    bool _started;
+    unsigned long _lastMillis;
+    uint8_t _direction;
+    unsigned long _pendingMillis;
+    uint8_t _pending[MODEM_TRACE_MAX_RECORD];
+    size_t _pendingLength;
+};
+
+// Streams the trace to a Print, e.g. a file on an SD card or a spare UART
+class ModemPrintTrace : public ModemTrace {
+
+public:
+    explicit ModemPrintTrace(Print &out);
+
+    virtual ~ModemPrintTrace();
+
+protected:
+    virtual void store(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t length,
+                       unsigned long ms);
+
+private:
+    Print &_out;
+    bool _headerWritten;
+};
+
+// Keeps the most recent records in RAM, the oldest records are dropped
+class ModemRingTrace : public ModemTrace {
+
+public:
+    /** Create a ring trace
+        @param buffer   Storage for the records
+        @param size     Size of the storage, at least MODEM_TRACE_MAX_RECORD + MODEM_TRACE_MAX_HEADER
+     */
+    ModemRingTrace(uint8_t *buffer, size_t size);
+
+    void clear();
+
+    /** Get the size of the stored records
+        @return bytes dump() writes after the file header
+     */
+    size_t length() const { return _length; }
+
+    /** Write the stored records as a complete trace
+        @param out      Output, e.g. Serial
+     */
+    void dump(Print &out);
+
+protected:
+    virtual void store(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t length,
+                       unsigned long ms);
+
+private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _tail;
+    size_t _length;
+    unsigned long _tailMillis;
+
+    size_t copyOut(size_t offset, uint8_t *data, size_t length) const;
+
+    void dropOldest();
+};
+
+#endif
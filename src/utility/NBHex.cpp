@@ -0,0 +1,234 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "NBHex.h"
+
+#define NB_HEX_ROW(h) \
+    h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" h "8" h "9" h "A" h "B" h "C" h "D" h "E" h "F"
+
+// "00" to "FF", the two characters of every byte value
+static const char HEX_PAIRS[] =
+        NB_HEX_ROW("0") NB_HEX_ROW("1") NB_HEX_ROW("2") NB_HEX_ROW("3")
+        NB_HEX_ROW("4") NB_HEX_ROW("5") NB_HEX_ROW("6") NB_HEX_ROW("7")
+        NB_HEX_ROW("8") NB_HEX_ROW("9") NB_HEX_ROW("A") NB_HEX_ROW("B")
+        NB_HEX_ROW("C") NB_HEX_ROW("D") NB_HEX_ROW("E") NB_HEX_ROW("F");
+
+#define XX -1
+
+// Value of every hex digit, -1 for all other characters
+static const int8_t HEX_VALUES[256] = {
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, XX, XX, XX, XX, XX, XX,
+        XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+
+#undef XX
+
+#if defined(__SSE2__)
+// 16 bytes at a time: split the nibbles, map them to '0'-'9'/'A'-'F' and interleave
+static size_t encodeSse2(const uint8_t *data, size_t length, char *out) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i digit = _mm_set1_epi8('0');
+    const __m128i letter = _mm_set1_epi8('A' - '0' - 10);
+    size_t done = 0;
+
+    for (; done + 16 <= length; done += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *) (data + done));
+        __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+        __m128i low = _mm_and_si128(bytes, nibble);
+
+        high = _mm_add_epi8(_mm_add_epi8(high, digit), _mm_and_si128(_mm_cmpgt_epi8(high, nine), letter));
+        low = _mm_add_epi8(_mm_add_epi8(low, digit), _mm_and_si128(_mm_cmpgt_epi8(low, nine), letter));
+
+        _mm_storeu_si128((__m128i *) (out + done * 2), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i *) (out + done * 2 + 16), _mm_unpackhi_epi8(high, low));
+    }
+
+    return done;
+}
+
+// Values of 16 hex digits, sets valid to false when one is not a digit
+static __m128i digitsSse2(__m128i chars, bool &valid) {
+    __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                    _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff) {
+        valid = false;
+    }
+
+    return _mm_or_si128(_mm_and_si128(isDigit, _mm_sub_epi8(chars, _mm_set1_epi8('0'))),
+                        _mm_and_si128(isLetter, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+}
+
+// 32 characters at a time: map them to nibbles and join the pairs
+static size_t decodeSse2(const uint8_t *hex, size_t size, uint8_t *out, bool &valid) {
+    const __m128i low = _mm_set1_epi16(0x00ff);
+    size_t done = 0;
+
+    for (; done + 16 <= size; done += 16) {
+        __m128i first = digitsSse2(_mm_loadu_si128((const __m128i *) (hex + done * 2)), valid);
+        __m128i second = digitsSse2(_mm_loadu_si128((const __m128i *) (hex + done * 2 + 16)), valid);
+
+        // each 16-bit lane holds the high nibble in its low byte
+        first = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, low), 4), _mm_srli_epi16(first, 8));
+        second = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, low), 4), _mm_srli_epi16(second, 8));
+
+        _mm_storeu_si128((__m128i *) (out + done), _mm_packus_epi16(first, second));
+    }
+
+    return done;
+}
+#endif
+
+size_t NBHex::encode(const uint8_t *data, size_t length, char *out) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    i = encodeSse2(data, length, out);
+#endif
+
+    // one 16-bit copy per byte, the compiler turns the memcpy into a halfword store
+    for (; i < length; i++) {
+        memcpy(out + i * 2, HEX_PAIRS + data[i] * 2, 2);
+    }
+
+    return NB_HEX_LENGTH(length);
+}
+
+size_t NBHex::encode(const NBSegment *segments, size_t count, size_t offset, size_t length, char *out) {
+    size_t written = 0;
+
+    for (size_t i = 0; i < count && length; i++) {
+        if (offset >= segments[i].length) {
+            offset -= segments[i].length;
+            continue;
+        }
+
+        size_t part = segments[i].length - offset;
+        if (part > length) {
+            part = length;
+        }
+
+        written += encode(segments[i].data + offset, part, out + written);
+        length -= part;
+        offset = 0;
+    }
+
+    return written;
+}
+
+size_t NBHex::length(const NBSegment *segments, size_t count) {
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        total += segments[i].length;
+    }
+
+    return total;
+}
+
+int NBHex::decode(const char *hex, size_t length, uint8_t *out) {
+    const uint8_t *in = (const uint8_t *) hex;
+
+    if (length & 1) {
+        return -1;
+    }
+
+    size_t size = length / 2;
+    size_t i = 0;
+    int invalid = 0;
+
+#if defined(__SSE2__)
+    bool valid = true;
+
+    i = decodeSse2(in, size, out, valid);
+    if (!valid) {
+        return -1;
+    }
+#endif
+
+    // no branch per byte, a bad character makes invalid negative
+    for (; i < size; i++) {
+        int high = HEX_VALUES[in[i * 2]];
+        int low = HEX_VALUES[in[i * 2 + 1]];
+
+        invalid |= high | low;
+        out[i] = (uint8_t) (((unsigned) high << 4) | (unsigned) low);
+    }
+
+    return invalid < 0 ? -1 : (int) size;
+}
+
+const char *NBHex::quoted(const char *line, size_t length, size_t &hexLength) {
+    if (length < 2 || line[length - 1] != '"') {
+        return NULL;
+    }
+
+    const char *end = line + length - 1;
+
+    // walk the quoted fields from the front, memchr skips the payload quickly
+    for (const char *quote = (const char *) memchr(line, '"', end - line); quote != NULL;) {
+        // always found, the line ends with a quote
+        const char *close = (const char *) memchr(quote + 1, '"', end + 1 - (quote + 1));
+
+        if (close == end) {
+            hexLength = end - (quote + 1);
+            return quote + 1;
+        }
+
+        quote = (const char *) memchr(close + 1, '"', end - (close + 1));
+    }
+
+    return NULL;
+}
+
+int NBHex::decodeQuoted(const char *line, size_t length, uint8_t *out, size_t size) {
+    size_t hexLength;
+    const char *hex = quoted(line, length, hexLength);
+
+    if (hex == NULL || hexLength > NB_HEX_LENGTH(size)) {
+        return -1;
+    }
+
+    return decode(hex, hexLength, out);
+}
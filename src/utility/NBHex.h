@@ -0,0 +1,90 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _NB_HEX_H_INCLUDED
+#define _NB_HEX_H_INCLUDED
+
+#include <Arduino.h>
+
+// Characters needed to hex encode length bytes
+#define NB_HEX_LENGTH(length) ((length) * 2)
+
+// Part of a payload held in its own buffer, for the scatter-gather writes
+struct NBSegment {
+    const uint8_t *data;
+    size_t length;
+};
+
+// Hex codec for the payloads of the socket commands (AT+USOWR, AT+USOST, ...)
+class NBHex {
+public:
+    /** Encode bytes as upper case hex, two characters per byte
+        @param data     Bytes to encode
+        @param length   Number of bytes
+        @param out      Destination, NB_HEX_LENGTH(length) characters, not null terminated
+        @return number of characters written
+     */
+    static size_t encode(const uint8_t *data, size_t length, char *out);
+
+    /** Encode a range of the bytes of several segments, as if they were one buffer
+        @param segments Segments
+        @param count    Number of segments
+        @param offset   First byte to encode, counted from the start of the first segment
+        @param length   Number of bytes, must not run past the last segment
+        @param out      Destination, NB_HEX_LENGTH(length) characters, not null terminated
+        @return number of characters written
+     */
+    static size_t encode(const NBSegment *segments, size_t count, size_t offset, size_t length, char *out);
+
+    /** Get the total length of segments
+        @param segments Segments
+        @param count    Number of segments
+        @return sum of the segment lengths
+     */
+    static size_t length(const NBSegment *segments, size_t count);
+
+    /** Decode hex, upper or lower case
+        @param hex      Characters to decode
+        @param length   Number of characters
+        @param out      Destination, length / 2 bytes
+        @return number of bytes decoded, -1 if length is odd or a character is not a hex digit
+     */
+    static int decode(const char *hex, size_t length, uint8_t *out);
+
+    /** Find the hex payload in the last quoted field of a response line
+        @param line     Response line
+        @param length   Length of the line
+        @param hexLength Set to the number of hex characters
+        @return first hex character, NULL if the line does not end with a quoted field
+     */
+    static const char *quoted(const char *line, size_t length, size_t &hexLength);
+
+    /** Decode the hex payload in the last quoted field of a response line, as in
+        +USORD: 0,4,"48454C4F" or +USORF: 0,"192.0.2.1",7,4,"48454C4F"
+        @param line     Response line
+        @param length   Length of the line
+        @param out      Destination
+        @param size     Size of the destination
+        @return number of bytes decoded, -1 if the line has no valid payload or it does not fit
+     */
+    static int decodeQuoted(const char *line, size_t length, uint8_t *out, size_t size);
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <stdlib.h>
+
+#include "NBSocketPool.h"
+
+#if NB_SOCKET_POOL_BLOCKS > 32
+#error NB_SOCKET_POOL_BLOCKS can be at most 32
+#endif
+
+#if NB_SOCKET_POOL_BLOCKS > 0
+static uint8_t pool[NB_SOCKET_POOL_BLOCKS * NB_SOCKET_BUFFER_SIZE];
+#else
+static uint8_t *const pool = NULL;
+#endif
+
+uint8_t *NBSocketPool::_arena = pool;
+int NBSocketPool::_blocks = NB_SOCKET_POOL_BLOCKS;
+uint32_t NBSocketPool::_inUse = 0;
+int NBSocketPool::_used = 0;
+int NBSocketPool::_peak = 0;
+unsigned long NBSocketPool::_heapAllocations = 0;
+unsigned long NBSocketPool::_failures = 0;
+
+uint8_t *NBSocketPool::allocate() {
+    for (int i = 0; i < _blocks; i++) {
+        if (!(_inUse & (1UL << i))) {
+            _inUse |= (1UL << i);
+
+            if (++_used > _peak) {
+                _peak = _used;
+            }
+
+            return _arena + i * NB_SOCKET_BUFFER_SIZE;
+        }
+    }
+
+#ifndef NB_SOCKET_NO_HEAP
+    uint8_t *block = (uint8_t *) malloc(NB_SOCKET_BUFFER_SIZE);
+
+    if (block != NULL) {
+        _heapAllocations++;
+        return block;
+    }
+#endif
+
+    _failures++;
+
+    return NULL;
+}
+
+void NBSocketPool::release(uint8_t *block) {
+    if (block == NULL) {
+        return;
+    }
+
+    if (_arena != NULL && block >= _arena && block < _arena + _blocks * NB_SOCKET_BUFFER_SIZE) {
+        _inUse &= ~(1UL << ((block - _arena) / NB_SOCKET_BUFFER_SIZE));
+        _used--;
+    } else {
+        free(block);
+    }
+}
+
+bool NBSocketPool::setArena(uint8_t *arena, size_t size) {
+    if (_inUse != 0) {
+        return false;
+    }
+
+    if (arena == NULL) {
+        _arena = pool;
+        _blocks = NB_SOCKET_POOL_BLOCKS;
+    } else {
+        size /= NB_SOCKET_BUFFER_SIZE;
+
+        _arena = arena;
+        _blocks = size > 32 ? 32 : (int) size;
+    }
+
+    return true;
+}
+
+void NBSocketPool::resetPeak() {
+    _peak = _used;
+}
@@ -0,0 +1,84 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef _NB_SOCKET_POOL_H_INCLUDED
+#define _NB_SOCKET_POOL_H_INCLUDED
+
+#include "NBSocketTable.h"
+
+// Socket buffers reserved statically, at most 32
+#ifndef NB_SOCKET_POOL_BLOCKS
+#define NB_SOCKET_POOL_BLOCKS 1
+#endif
+
+// Define NB_SOCKET_NO_HEAP to never allocate socket buffers on the heap:
+// a socket gets no buffer, and receives nothing, once the pool is exhausted.
+
+// Fixed pool of NB_SOCKET_BUFFER_SIZE blocks for the socket receive buffers,
+// so sockets that come and go don't fragment the heap
+class NBSocketPool {
+
+public:
+    /** Take a block from the pool, or from the heap once the pool is exhausted
+        @return block of NB_SOCKET_BUFFER_SIZE bytes, NULL if none is left
+     */
+    static uint8_t *allocate();
+
+    /** Return a block taken with allocate()
+        @param block    Block, NULL is ignored
+     */
+    static void release(uint8_t *block);
+
+    /** Use caller supplied memory instead of the static pool
+        Only possible while no block is in use.
+        @param arena    Memory for the blocks, NULL to go back to the static pool
+        @param size     Size of the arena, a multiple of NB_SOCKET_BUFFER_SIZE
+        @return true if the arena is used
+     */
+    static bool setArena(uint8_t *arena, size_t size);
+
+    static int blocks() { return _blocks; }
+
+    static int used() { return _used; }
+
+    /** Get the most blocks in use at the same time since the last resetPeak()
+        @return peak pool occupancy, not counting heap blocks
+     */
+    static int peak() { return _peak; }
+
+    // Blocks taken from the heap because the pool was exhausted
+    static unsigned long heapAllocations() { return _heapAllocations; }
+
+    // Allocations refused, the pool was exhausted and the heap not allowed or full
+    static unsigned long failures() { return _failures; }
+
+    static void resetPeak();
+
+private:
+    static uint8_t *_arena;
+    static int _blocks;
+    static uint32_t _inUse;
+    static int _used;
+    static int _peak;
+    static unsigned long _heapAllocations;
+    static unsigned long _failures;
+};
+
+#endif
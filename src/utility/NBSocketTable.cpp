@@ -0,0 +1,429 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../Modem.h"
+
+#include "NBHex.h"
+#include "NBSocketPool.h"
+#include "NBSocketTable.h"
+
+
+// Time allowed for a read, and the longest single wait for the modem while reading
+#define NB_SOCKET_READ_TIMEOUT 10000
+#define NB_SOCKET_WAIT_TIMEOUT 1000
+
+// Time the modem may take to close a socket
+#define NB_SOCKET_CLOSE_TIMEOUT 10000
+
+NBSocketTable::NBSocketTable(Modem &modem) : _modem(modem) {
+    memset(&_sockets, 0x00, sizeof(_sockets));
+}
+
+NBSocketTable::~NBSocketTable() {
+    for (int i = 0; i < MODEM_NUM_SOCKETS; i++) {
+        close(i);
+    }
+}
+
+void NBSocketTable::create(int protocol) {
+    waitForClose();
+    _modem.sendf("AT+USOCR=%d", protocol);
+}
+
+void NBSocketTable::open(int socket, bool datagram) {
+    // after a fast close the modem may hand out the id before its +UUSOCL, which must not close the new socket
+    uint8_t closing = _sockets[socket].closing == CLOSE_WAIT_URC ? CLOSE_WAIT_URC : CLOSE_NONE;
+
+    close(socket);
+    _sockets[socket].closing = closing;
+    _sockets[socket].datagram = datagram;
+}
+
+void NBSocketTable::close(int socket) {
+    Socket &entry = _sockets[socket];
+
+    if (entry.requested) {
+        // a read already sent still completes, into nothing
+        _modem.cancel(&entry);
+    }
+
+    NBSocketPool::release(entry.data);
+
+    memset(&entry, 0x00, sizeof(entry));
+}
+
+void NBSocketTable::requestClose(int socket, bool fast) {
+    close(socket);
+
+    _sockets[socket].closing = fast ? CLOSE_DEFERRED_FAST : CLOSE_DEFERRED;
+    queueClose(socket);
+}
+
+void NBSocketTable::retryCloses() {
+    for (int i = 0; i < MODEM_NUM_SOCKETS; i++) {
+        if ((_sockets[i].closing == CLOSE_DEFERRED || _sockets[i].closing == CLOSE_DEFERRED_FAST) &&
+            !queueClose(i)) {
+            return;
+        }
+    }
+}
+
+bool NBSocketTable::queueClose(int socket) {
+    Socket &entry = _sockets[socket];
+    bool fast = entry.closing == CLOSE_DEFERRED_FAST;
+    char command[24];
+
+    // a full queue leaves the close to retryCloses(), this may run from a URC handler
+    snprintf(command, sizeof(command), fast ? "AT+USOCL=%d,1" : "AT+USOCL=%d", socket);
+    if (!_modem.enqueue(command, NB_SOCKET_CLOSE_TIMEOUT, closeCompleted, &entry)) {
+        return false;
+    }
+
+    entry.closing = fast ? CLOSE_QUEUED_FAST : CLOSE_QUEUED;
+    return true;
+}
+
+void NBSocketTable::closeCompleted(int result, const String & /*response*/, void *context) {
+    Socket &entry = *(Socket *) context;
+
+    // after the OK of a fast close the modem still closes the connection, +UUSOCL reports when it is done
+    if (result == MODEM_RESULT_OK && entry.closing == CLOSE_QUEUED_FAST) {
+        entry.closing = CLOSE_WAIT_URC;
+    } else {
+        entry.closing = CLOSE_NONE;
+    }
+}
+
+bool NBSocketTable::closeQueued() const {
+    for (int i = 0; i < MODEM_NUM_SOCKETS; i++) {
+        if (_sockets[i].closing != CLOSE_NONE && _sockets[i].closing != CLOSE_WAIT_URC) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void NBSocketTable::waitForClose() {
+    // the wait also returns when the queue is due, so poll() right after it
+    while (closeQueued()) {
+        _modem.waitForData(NB_SOCKET_WAIT_TIMEOUT);
+        _modem.poll();
+    }
+}
+
+void NBSocketTable::announce(int socket, int length) {
+    _sockets[socket].pending = length;
+    _sockets[socket].announced = true;
+}
+
+bool NBSocketTable::startRead(int socket) {
+    Socket &entry = _sockets[socket];
+    int length = NB_SOCKET_READ_SIZE;
+    char command[24];
+
+    if (entry.data == NULL) {
+        entry.data = NBSocketPool::allocate();
+        entry.start = entry.length = 0;
+
+        if (entry.data == NULL) {
+            return false;
+        }
+    }
+
+    if (entry.pending > 0 && entry.pending < length) {
+        length = entry.pending;
+    }
+
+    if (NB_SOCKET_BUFFER_SIZE - entry.length < length) {
+        length = NB_SOCKET_BUFFER_SIZE - entry.length;
+    }
+
+    snprintf(command, sizeof(command), "AT+USORD=%d,%d", socket, length);
+    if (!_modem.enqueue(command, NB_SOCKET_READ_TIMEOUT, readCompleted, &entry)) {
+        return false;
+    }
+
+    // the announced bytes the read will fetch are not pending anymore
+    if (entry.pending > 0) {
+        entry.pending -= length;
+    }
+
+    entry.requested = length;
+    entry.announced = false;
+
+    return true;
+}
+
+void NBSocketTable::readAhead(int socket) {
+    Socket &entry = _sockets[socket];
+
+    if (entry.requested || entry.datagram || entry.pending == 0 || entry.data == NULL) {
+        return;
+    }
+
+    int room = NB_SOCKET_BUFFER_SIZE - entry.length;
+    int wanted = NB_SOCKET_READ_SIZE;
+
+    if (entry.pending > 0 && entry.pending < wanted) {
+        wanted = entry.pending;
+    }
+
+    // small reads cost a round trip each, wait until a worthwhile read fits
+    if (room >= wanted || room >= NB_SOCKET_READ_AHEAD_MIN) {
+        startRead(socket);
+    }
+}
+
+void NBSocketTable::readCompleted(int result, const String &response, void *context) {
+    Socket &entry = *(Socket *) context;
+    int requested = entry.requested;
+    int size = 0;
+
+    entry.requested = 0;
+
+    if (result != MODEM_RESULT_OK) {
+        // the modem refuses to read closed sockets, whatever they held is gone
+        if (result == MODEM_RESULT_ERROR || result == MODEM_RESULT_CME_ERROR) {
+            entry.closed = true;
+            entry.pending = 0;
+        }
+
+        return;
+    }
+
+    size_t hexLength;
+    const char *hex = NBHex::quoted(response.c_str(), response.length(), hexLength);
+
+    if (response.startsWith("+USORD: ") && hex != NULL &&
+        hexLength <= (size_t) NB_HEX_LENGTH(NB_SOCKET_BUFFER_SIZE - entry.length)) {
+        // the bytes may wrap around the end of the ring
+        int tail = (entry.start + entry.length) % NB_SOCKET_BUFFER_SIZE;
+        int first = NB_SOCKET_BUFFER_SIZE - tail;
+
+        size = hexLength / 2;
+        if (first > size) {
+            first = size;
+        }
+
+        if (NBHex::decode(hex, NB_HEX_LENGTH(first), entry.data + tail) < 0 ||
+            NBHex::decode(hex + NB_HEX_LENGTH(first), hexLength - NB_HEX_LENGTH(first), entry.data) < 0) {
+            size = 0;
+        }
+    }
+
+    entry.length += size;
+
+    // a short read emptied the modem, unless it announced new data meanwhile
+    if (size < requested && !entry.announced) {
+        entry.pending = 0;
+    }
+}
+
+int NBSocketTable::receiveFrom(int socket, IPAddress &ip, uint16_t &port) {
+    Socket &entry = _sockets[socket];
+    String response;
+
+    if (entry.pending == 0) {
+        return 0;
+    }
+    entry.pending = 0;
+
+    if (entry.data == NULL) {
+        entry.data = NBSocketPool::allocate();
+
+        if (entry.data == NULL) {
+            return 0;
+        }
+    }
+    entry.start = entry.length = 0;
+
+    _modem.sendf("AT+USORF=%d,%d", socket, NB_SOCKET_READ_SIZE);
+    if (_modem.waitForResponse(NB_SOCKET_READ_TIMEOUT, &response) != 1 || !response.startsWith("+USORF: ")) {
+        return 0;
+    }
+
+    // +USORF: <socket>,"<ip>",<port>,<length>,"<data>"
+    const char *address = strchr(response.c_str(), '"');
+    const char *addressEnd = (address != NULL) ? strchr(address + 1, '"') : NULL;
+    char text[16];
+
+    if (addressEnd == NULL || addressEnd[1] != ',' || (size_t) (addressEnd - address - 1) >= sizeof(text)) {
+        return 0;
+    }
+
+    memcpy(text, address + 1, addressEnd - address - 1);
+    text[addressEnd - address - 1] = '\0';
+
+    int size = NBHex::decodeQuoted(response.c_str(), response.length(), entry.data, NB_SOCKET_BUFFER_SIZE);
+    if (size < 0) {
+        return 0;
+    }
+
+    ip.fromString(text);
+    port = atoi(addressEnd + 2);
+    entry.length = size;
+
+    return size;
+}
+
+int NBSocketTable::available(int socket) {
+    Socket &entry = _sockets[socket];
+    unsigned long start = millis();
+
+    // wait until the read in progress, or a new one, brings data, a closed socket keeps the data announced before
+    while (entry.length == 0 && !entry.datagram && (entry.requested || entry.pending != 0)) {
+        if (!entry.requested && !startRead(socket) && entry.data == NULL) {
+            return 0;
+        }
+
+        if ((millis() - start) >= NB_SOCKET_READ_TIMEOUT) {
+            return 0;
+        }
+
+        _modem.poll();
+
+        // both a read in progress and a full queue only move on with modem data
+        if (entry.length == 0 && (entry.requested || entry.pending != 0)) {
+            _modem.waitForData(NB_SOCKET_WAIT_TIMEOUT);
+        }
+    }
+
+    if (entry.length == 0) {
+        return entry.closed ? -1 : 0;
+    }
+
+    readAhead(socket);
+
+    return entry.length;
+}
+
+int NBSocketTable::peek(int socket) {
+    if (available(socket) <= 0) {
+        return -1;
+    }
+
+    return _sockets[socket].data[_sockets[socket].start];
+}
+
+int NBSocketTable::read(int socket, uint8_t *data, size_t length) {
+    Socket &entry = _sockets[socket];
+    int avail = available(socket);
+
+    if (avail <= 0) {
+        return 0;
+    }
+
+    if (avail < (int) length) {
+        length = avail;
+    }
+
+    // the bytes may wrap around the end of the ring
+    size_t first = NB_SOCKET_BUFFER_SIZE - entry.start;
+
+    if (first > length) {
+        first = length;
+    }
+
+    memcpy(data, entry.data + entry.start, first);
+    memcpy(data + first, entry.data, length - first);
+
+    consume(socket, length);
+
+    return length;
+}
+
+size_t NBSocketTable::span(int socket, const uint8_t **data) const {
+    const Socket &entry = _sockets[socket];
+    size_t length = NB_SOCKET_BUFFER_SIZE - entry.start;
+
+    if (length > (size_t) entry.length) {
+        length = entry.length;
+    }
+
+    *data = entry.data + entry.start;
+
+    return length;
+}
+
+void NBSocketTable::consume(int socket, size_t length) {
+    Socket &entry = _sockets[socket];
+
+    if (length > (size_t) entry.length) {
+        length = entry.length;
+    }
+
+    entry.start = (entry.start + length) % NB_SOCKET_BUFFER_SIZE;
+    entry.length -= length;
+
+    if (entry.length == 0) {
+        entry.start = 0;
+    }
+
+    // refill while the application works on what it read
+    readAhead(socket);
+}
+
+void NBSocketTable::handleUrc(const char *urc) {
+    // +UUSORD: <socket>,<length>, +UUSORF: <socket>,<length> or +UUSOCL: <socket>
+    const char *parameters = strchr(urc, ':');
+
+    if (parameters == NULL) {
+        return;
+    }
+
+    int socket = atoi(parameters + 1);
+
+    if (socket < 0 || socket >= MODEM_NUM_SOCKETS) {
+        return;
+    }
+
+    if (strncmp(urc, "+UUSOCL:", 8) == 0) {
+        // the end of a fast close, possibly after the id was handed out again
+        if (_sockets[socket].closing == CLOSE_WAIT_URC) {
+            _sockets[socket].closing = CLOSE_NONE;
+        } else if (_sockets[socket].closing == CLOSE_QUEUED_FAST) {
+            // closed before AT+USOCL ran, no other +UUSOCL follows its OK
+            _sockets[socket].closing = CLOSE_QUEUED;
+        } else if (_sockets[socket].closing == CLOSE_DEFERRED_FAST) {
+            _sockets[socket].closing = CLOSE_DEFERRED;
+        } else {
+            _sockets[socket].closed = true;
+        }
+        return;
+    }
+
+    const char *length = strrchr(parameters, ',');
+
+    if (length == NULL) {
+        return;
+    }
+
+    if (strcmp(length, ",4294967295") == 0) {
+        _sockets[socket].closed = true;
+    } else {
+        // the length is everything the modem holds, not just the new bytes
+        announce(socket, atoi(length + 1));
+    }
+}
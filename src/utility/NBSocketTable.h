@@ -0,0 +1,216 @@
+/*
+  This file is part of the MKR NB library.
+  Copyright (c) 2018 Arduino SA. All rights reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+// The table is part of the Modem, Modem.h includes this header where the
+// types the table needs are declared, so include it first
+#include "../Modem.h"
+
+#ifndef _NB_SOCKET_TABLE_H_INCLUDED
+#define _NB_SOCKET_TABLE_H_INCLUDED
+
+// Receive buffer of a socket, a multiple of NB_SOCKET_READ_SIZE keeps the reads full
+#ifndef NB_SOCKET_BUFFER_SIZE
+#define NB_SOCKET_BUFFER_SIZE 1024
+#endif
+
+// Longest AT+USORD read, the modem returns at most 1024 bytes and the hex
+// encoded response has to fit in the line buffer of the Modem
+#ifndef NB_SOCKET_READ_SIZE
+#if MODEM_LINE_BUFFER_SIZE >= 2112
+#define NB_SOCKET_READ_SIZE 1024
+#else
+#define NB_SOCKET_READ_SIZE ((MODEM_LINE_BUFFER_SIZE - 64) / 2)
+#endif
+#endif
+
+// Free space needed to read ahead before the buffer is drained
+#ifndef NB_SOCKET_READ_AHEAD_MIN
+#define NB_SOCKET_READ_AHEAD_MIN 256
+#endif
+
+// Pending length of a socket whose received data was never announced
+#define NB_SOCKET_PENDING_UNKNOWN -1
+
+class Modem;
+
+/*
+  State and receive buffer of every socket of the modem, indexed by socket id
+  and shared by NBClient, NBSSLClient and NBUDP. The table follows the socket
+  URCs (+UUSORD, +UUSORF, +UUSOCL) itself, clients only keep the socket id.
+*/
+class NBSocketTable : public ModemUrcHandler {
+
+public:
+    NBSocketTable(Modem &modem);
+
+    virtual ~NBSocketTable();
+
+    /** Send AT+USOCR for a new socket, its response is read as usual
+        Waits for queued closes first, the modem could hand out the id of a
+        socket that is about to be closed.
+        @param protocol 6 for TCP, 17 for UDP
+     */
+    void create(int protocol);
+
+    /** Start tracking a socket the modem created
+        @param socket   Socket
+        @param datagram true for a UDP socket, its buffer holds the datagram receiveFrom() read
+     */
+    void open(int socket, bool datagram = false);
+
+    /** Stop tracking a socket and release its buffer
+        @param socket   Socket
+     */
+    void close(int socket);
+
+    /** Close a socket on the modem in the background and stop tracking it
+        AT+USOCL runs from the command queue, closing() is true until its OK, or
+        with a fast close until +UUSOCL, arrives. With a full queue AT+USOCL is
+        queued by retryCloses() later, so this never waits for the modem.
+        The modem may hand out the socket id again once it answered AT+USOCL, so
+        a new socket is only created when closeQueued() is false. The +UUSOCL of
+        a fast close that arrives after that only ends the close.
+        @param socket   Socket
+        @param fast     Use the asynchronous close of the firmware (AT+USOCL=<socket>,1), TCP only
+     */
+    void requestClose(int socket, bool fast = false);
+
+    /** Queue the closes requestClose() could not queue, the modem calls this when the queue has room
+     */
+    void retryCloses();
+
+    /** Check if a close requested with requestClose() is still running
+        @param socket   Socket
+        @return true until the modem completed the close
+     */
+    bool closing(int socket) const { return _sockets[socket].closing != CLOSE_NONE; }
+
+    /** Check if an AT+USOCL requested with requestClose() is deferred or still waits for its answer
+        @return true while AT+USOCR could return a socket id that is about to be closed
+     */
+    bool closeQueued() const;
+
+    /** Wait until closeQueued() is false
+     */
+    void waitForClose();
+
+    /** Check if the modem reported the socket closed
+        @param socket   Socket
+        @return true once +UUSOCL or a failed read showed the socket closed
+     */
+    bool closed(int socket) const { return _sockets[socket].closed; }
+
+    /** Record the unread length announced by +UUSORD or +UUSORF
+        @param socket   Socket
+        @param length   Bytes waiting in the modem, NB_SOCKET_PENDING_UNKNOWN if not known
+     */
+    void announce(int socket, int length);
+
+    /** Get the unread length announced by the modem
+        @param socket   Socket
+        @return bytes waiting in the modem, NB_SOCKET_PENDING_UNKNOWN if not known
+     */
+    int pending(int socket) const { return _sockets[socket].pending; }
+
+    /** Get the bytes read from the modem and not yet consumed
+        @param socket   Socket
+        @return bytes in the receive buffer
+     */
+    int buffered(int socket) const { return _sockets[socket].length; }
+
+    /** Check if an AT+USORD of the socket is queued or executing
+        @param socket   Socket
+        @return true until the bytes it fetches are in the receive buffer
+     */
+    bool reading(int socket) const { return _sockets[socket].requested != 0; }
+
+    /** Read the next datagram announced by +UUSORF into the receive buffer
+        What is left of the previous datagram is dropped. Waits for the modem.
+        @param socket   Socket opened as datagram socket
+        @param ip       Set to the address of the sender
+        @param port     Set to the port of the sender
+        @return size of the datagram, 0 if none was announced or the read failed
+     */
+    int receiveFrom(int socket, IPAddress &ip, uint16_t &port);
+
+    /** Bytes buffered, reads from the modem only when it announced data
+        Waits for the modem when the buffer is empty, and reads ahead in the
+        background while there is room for more.
+        @param socket   Socket
+        @return bytes available, -1 once the socket is closed and its data was read
+     */
+    int available(int socket);
+
+    int peek(int socket);
+
+    int read(int socket, uint8_t *data, size_t length);
+
+    /** Get the buffered bytes up to the end of the ring, without copying them
+        Call available() first, the bytes stay valid until they are consumed.
+        @param socket   Socket
+        @param data     Set to the first buffered byte
+        @return number of contiguous bytes, 0 if none are buffered
+     */
+    size_t span(int socket, const uint8_t **data) const;
+
+    /** Drop bytes from the front of the buffer and read ahead
+        @param socket   Socket
+        @param length   Bytes, at most the number buffered
+     */
+    void consume(int socket, size_t length);
+
+    virtual void handleUrc(const char *urc);
+
+private:
+    enum {
+        CLOSE_NONE,
+        CLOSE_DEFERRED,
+        CLOSE_DEFERRED_FAST,
+        CLOSE_QUEUED,
+        CLOSE_QUEUED_FAST,
+        CLOSE_WAIT_URC
+    };
+
+    struct Socket {
+        uint8_t *data;
+        int start;
+        int length;
+        int pending;
+        int requested; // length of the read in progress, 0 if none
+        bool announced; // +UUSORD arrived during the read
+        bool closed;
+        bool datagram; // UDP, read by receiveFrom() only
+        uint8_t closing; // CLOSE_DEFERRED..., CLOSE_QUEUED... or CLOSE_WAIT_URC while requestClose() runs
+    };
+
+    Modem& _modem;
+    Socket _sockets[MODEM_NUM_SOCKETS];
+
+    bool startRead(int socket);
+
+    void readAhead(int socket);
+
+    static void readCompleted(int result, const String &response, void *context);
+
+    bool queueClose(int socket);
+    static void closeCompleted(int result, const String &response, void *context);
+};
+
+#endif